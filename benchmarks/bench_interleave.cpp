@@ -0,0 +1,27 @@
+#include <cassert>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+
+#include "project.h"
+
+
+// Benchmarks interleaved execution (IndexStmt::interleave) of a sparse
+// vector gathering from a dense vector much larger than the last-level cache.
+int main(const int argc, const char** argv) {
+    Index i{"i"};
+    Array A{"A"}, B{"B"}, C{"C"};
+
+    Assignment a = (A(i) = B(i) * C(i));
+    FormatMap formats = {
+        {"A", {Format::Dense}},
+        {"B", {Format::Compressed}},
+        {"C", {Format::Dense}},
+    };
+
+    IndexStmt stmt = lower(a).interleave(i, 8);
+    LIR::Stmt lstmt = lower(stmt, formats);
+    compile_and_test(lstmt, {"A", "B", "C"}, "benchmarks/bench_interleave_runner.cpp");
+
+    return 0;
+}
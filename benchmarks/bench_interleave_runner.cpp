@@ -0,0 +1,70 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+
+#include "utils.h"
+
+
+// The same computation, iterating positions in order.
+void reference(array &A, const array &B, const array &C) {
+  for (uint64_t p = B.pos[0]; p < B.pos[1]; p++) {
+    const uint64_t i = B.crd[p];
+    A.values[i] = B.values[p] * C.values[i];
+  }
+}
+
+// A sparse array with each coordinate present with probability density.
+array bernoulli_sparse_array(const uint64_t N, const double density) {
+    array A;
+    A.shape = new uint64_t[1]();
+    A.shape[0] = N;
+    A.pos = new uint64_t[2]();
+    A.crd = new uint64_t[N];
+    A.values = new float[N];
+    uint64_t count = 0;
+    for (uint64_t i = 0; i < N; i++) {
+        if (rand() < density * RAND_MAX) {
+            A.crd[count] = i;
+            A.values[count] = static_cast<float>(rand()) / static_cast<float>(RAND_MAX);
+            count++;
+        }
+    }
+    A.pos[1] = count;
+    return A;
+}
+
+template<typename F>
+double best_seconds(const int repeats, const F &f) {
+    double best = 1e30;
+    for (int r = 0; r < repeats; r++) {
+        const auto start = std::chrono::steady_clock::now();
+        f();
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+void run_benchmark(const uint64_t N, const double density) {
+    array A_kernel = empty_dense_array(N);
+    array A_ref = empty_dense_array(N);
+    array B = bernoulli_sparse_array(N, density);
+    array C = random_dense_array(N);
+
+    const double interleaved = best_seconds(5, [&] { kernel(A_kernel, B, C); });
+    const double in_order = best_seconds(5, [&] { reference(A_ref, B, C); });
+    assert_dense_array_match(A_kernel, A_ref, N);
+
+    std::cout << "N=" << N << " nnz=" << B.pos[1] << " (" << (2 * N * sizeof(float) >> 20) << " MiB dense)"
+              << " in order: " << in_order * 1e3 << " ms, interleaved: " << interleaved * 1e3 << " ms"
+              << ", speedup " << in_order / interleaved << "x\n";
+}
+
+int main(const int argc, const char** argv) {
+    srand(0);
+    // Dense vectors well beyond a typical last-level cache.
+    run_benchmark(uint64_t(1) << 25, 0.01);
+    run_benchmark(uint64_t(1) << 25, 0.1);
+    run_benchmark(uint64_t(1) << 27, 0.01);
+}
@@ -0,0 +1,56 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include "project.h"
+
+
+// Benchmarks lowering of wide expressions: K compressed operands, each
+// scaled by 4 dense ones, summed and scaled once more, i.e. 5K + 1 operands
+// with a lattice of 2^K - 1 points.
+int main(const int argc, const char** argv) {
+    Index i{"i"};
+    Array A{"A"}, E{"E"};
+
+    for (int K = 6; K <= 9; K++) {
+        FormatMap formats = {
+            {"A", {Format::Dense}},
+            {"E", {Format::Dense}},
+        };
+        Expr sum;
+        for (int k = 0; k < K; k++) {
+            const std::string name = "B" + std::to_string(k);
+            formats[name] = {Format::Compressed};
+            Expr term = Array{name}(i);
+            for (int d = 0; d < 4; d++) {
+                const std::string dense = "D" + std::to_string(k) + "_" + std::to_string(d);
+                formats[dense] = {Format::Dense};
+                term = term * Array{dense}(i);
+            }
+            sum = sum.defined() ? sum + term : term;
+        }
+
+        // Best of a few runs, with IR nodes from the heap, then from an
+        // arena (see Arena.h).
+        const Assignment assignment = (A(i) = sum * E(i));
+        double heap = 1e30, arena = 1e30;
+        for (int r = 0; r < 5; r++) {
+            for (const bool use_arena : {false, true}) {
+                const auto start = std::chrono::steady_clock::now();
+                {
+                    std::unique_ptr<IRArena> scope(use_arena ? new IRArena() : nullptr);
+                    LIR::Stmt lstmt = lower(lower(assignment), formats);
+                }
+                const auto end = std::chrono::steady_clock::now();
+                double &best = use_arena ? arena : heap;
+                best = std::min(best, std::chrono::duration<double>(end - start).count());
+            }
+        }
+        std::cout << 5 * K + 1 << " operands: " << heap << " s from the heap, " << arena << " s from an arena\n";
+    }
+
+    return 0;
+}
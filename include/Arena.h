@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// Per-compilation arenas for IR nodes. While an IRArena is in scope on a
+// thread, the make() factories of IndexStmt and LIR nodes (see make_node)
+// bump-allocate each node, together with its reference counts, from the
+// arena rather than the heap. Nodes are never freed one by one: the arena's
+// blocks are released in one shot when it goes out of scope, so nodes made
+// in the scope must not outlive it. Interned nodes (see Intern.h) may be
+// handed to later compilations, so they always come from the heap.
+class IRArena {
+public:
+    IRArena();
+    ~IRArena();
+
+    IRArena(const IRArena &) = delete;
+    IRArena &operator=(const IRArena &) = delete;
+
+    // Bytes allocated from this arena so far.
+    size_t allocated() const;
+
+    // The innermost arena in scope on this thread, or nullptr.
+    static IRArena *current();
+
+    // The blocks of an arena.
+    struct Blocks {
+        std::vector<std::unique_ptr<char[]>> blocks;
+        char *next = nullptr;
+        size_t remaining = 0;
+        size_t allocated = 0;
+        // Nodes allocated and not yet destroyed, which must be none once the
+        // arena is out of scope.
+        size_t live = 0;
+
+        void *allocate(const size_t bytes, const size_t alignment);
+    };
+
+private:
+    template<typename T>
+    friend struct ArenaAllocator;
+    template<typename T, typename... Args>
+    friend std::shared_ptr<T> make_node(Args &&...args);
+
+    Blocks blocks;
+    IRArena *previous;
+};
+
+// Allocator for std::allocate_shared from an arena. It is a plain pointer to
+// the arena's blocks, so nodes pay no reference counting for it, and
+// deallocation only counts the node as gone.
+template<typename T>
+struct ArenaAllocator {
+    using value_type = T;
+
+    IRArena::Blocks *blocks;
+
+    explicit ArenaAllocator(IRArena::Blocks *_blocks)
+        : blocks(_blocks) {}
+    template<typename U>
+    ArenaAllocator(const ArenaAllocator<U> &other)
+        : blocks(other.blocks) {}
+
+    T *allocate(const size_t n) {
+        blocks->live++;
+        return static_cast<T *>(blocks->allocate(n * sizeof(T), alignof(T)));
+    }
+    void deallocate(T *, const size_t) {
+        blocks->live--;
+    }
+
+    template<typename U>
+    bool operator==(const ArenaAllocator<U> &other) const {
+        return blocks == other.blocks;
+    }
+    template<typename U>
+    bool operator!=(const ArenaAllocator<U> &other) const {
+        return blocks != other.blocks;
+    }
+};
+
+// Allocate an IR node from the current arena, or the heap if there is none.
+template<typename T, typename... Args>
+std::shared_ptr<T> make_node(Args &&...args) {
+    if (IRArena *arena = IRArena::current()) {
+        return std::allocate_shared<T>(ArenaAllocator<T>(&arena->blocks), std::forward<Args>(args)...);
+    }
+    return std::make_shared<T>(std::forward<Args>(args)...);
+}
+
+// make_node for IR nodes tagged with their kind (T::node_kind).
+template<typename T, typename... Args>
+std::shared_ptr<T> make_tagged_node(Args &&...args) {
+    std::shared_ptr<T> node = make_node<T>(std::forward<Args>(args)...);
+    node->kind = T::node_kind;
+    return node;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Array.h"
+#include "Format.h"
+
+// Chooses the formats of an assignment's operands by compiling the kernel
+// with each candidate FormatMap (see compile in JIT.h) and timing it on
+// sample data.
+
+// Sample operands of an assignment, as the kernel would be called on them.
+struct FormatSample {
+    // Extent of every array.
+    uint64_t extent = 0;
+    // Value of each operand at every coordinate, zero where it has no
+    // nonzero. Missing operands are all zero.
+    std::map<std::string, std::vector<float>> values;
+    // Formats the operands and the output are stored in by the caller. An
+    // operand a candidate reads in another format is converted on every call,
+    // and the conversion is timed with the kernel. The output must be dense.
+    FormatMap formats;
+};
+
+// Tuning more operands than this is refused: every operand doubles the
+// number of candidates, each compiled and timed separately.
+constexpr size_t autotune_max_operands = 6;
+
+// Every FormatMap with each operand of assignment Dense or Compressed, and
+// the output in its format in formats.
+std::vector<FormatMap> candidate_formats(const Assignment &assignment, const FormatMap &formats);
+
+// Sets seconds to the best seconds per call, over a few calls, of
+// assignment compiled with formats on sample, including converting operands
+// from sample.formats. Returns false if the kernel or its timing harness
+// failed to build or run.
+bool time_formats(const Assignment &assignment, const FormatMap &formats, const FormatSample &sample, double &seconds);
+
+// The fastest of candidate_formats(assignment, sample.formats) on sample.
+// Candidates that fail to build or run are skipped. Winners are persisted in
+// cache_file, keyed by the assignment, the formats of sample and the density
+// of each operand to a power of two, and samples with the same key reuse
+// them without tuning again. If no candidate could be timed, this is
+// sample.formats, and nothing is persisted.
+FormatMap autotune_formats(const Assignment &assignment, const FormatSample &sample, const std::string &cache_file);
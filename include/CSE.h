@@ -0,0 +1,12 @@
+#pragma once
+
+#include "LIR.h"
+
+// Common-subexpression elimination for the body of a lattice point: an
+// ArrayAssignment, or a SequenceStmt of them (see Multi). Values are
+// numbered by structure, with the operands of commutative operations in a
+// canonical order, so each distinct subexpression is one node of a DAG.
+// Subexpressions used more than once, including repeated loads of the same
+// operand, are computed once into a local (cse_t0, cse_t1, ...) that every
+// use then reads. Other statements are returned unchanged.
+LIR::Stmt eliminate_common_subexpressions(const LIR::Stmt &body);
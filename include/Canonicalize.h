@@ -0,0 +1,17 @@
+#pragma once
+
+#include <string>
+
+#include "Array.h"
+#include "Format.h"
+
+// Canonical form of assignment: the operands of every addition and
+// multiplication are ordered by their printed canonical form. Only operands
+// of the same operation are swapped, never reassociated, so the result
+// rounds exactly like the original.
+Assignment canonicalize(const Assignment &assignment);
+
+// Key identifying the kernel of assignment: its canonical form and the
+// formats of its arrays. Assignments that differ only in the order of
+// commutative operands have the same key.
+std::string kernel_cache_key(const Assignment &assignment, const FormatMap &formats);
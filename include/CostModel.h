@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+#include "LIR.h"
+
+// A static cost model over lowered kernels, used to choose between lowering
+// strategies (see lower(IndexStmt, FormatMap, OperandStatsMap)).
+
+// Statistics of an operand: its extent N and its number of nonzeros (N for a
+// dense operand). For an array a, these are a.shape[0] and, if compressed,
+// a.pos[1] - a.pos[0].
+struct OperandStats {
+    uint64_t extent = 0;
+    uint64_t nnz = 0;
+};
+
+// Statistics by array name. Arrays without stats are taken to be full.
+using OperandStatsMap = std::map<std::string, OperandStats>;
+
+// Estimated cost of one run of a kernel.
+struct KernelCost {
+    // Arithmetic, comparisons and branches.
+    double operations = 0;
+    // Bytes of values and coordinates read and written.
+    double bytes = 0;
+
+    // One number to compare kernels by: operations, with every
+    // cost_bytes_per_operation bytes moved counting as one more.
+    double total() const;
+};
+
+constexpr double cost_bytes_per_operation = 4;
+
+// Estimate the cost of running stmt on operands with the given stats.
+// Nonzeros are assumed to be spread uniformly and independently over the
+// coordinates, so an operand with density d = nnz / N is present at a
+// coordinate with probability d. Each loop's trip count, and how often each
+// branch of its body is taken, follows from the densities of its iterators.
+// Dense runs (see DenseRunStmt) are assumed to be rare.
+KernelCost estimate_cost(const LIR::Stmt &stmt, const OperandStatsMap &stats);
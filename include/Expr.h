@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <type_traits>
@@ -10,7 +12,19 @@
 // Forward declare IRVisitor for ExprNode accept method.
 struct IRVisitor;
 
+// Kind tags of Expr nodes, for dispatch without dynamic casts (see Expr::as).
+enum class ExprKind {
+    ArrayRead,
+    Add,
+    Mul,
+};
+
 struct ExprNode {
+    // Set by make(), which interns nodes (see Intern.h): structurally equal
+    // expressions are the same node, with the same id and hash.
+    ExprKind kind;
+    uint64_t id = 0;
+    size_t hash = 0;
     virtual void accept(IRVisitor *v) const = 0;
     ExprNode() {}
     virtual ~ExprNode() = default;
@@ -37,16 +51,38 @@ struct Expr {
         return ptr != nullptr;
     }
 
+    // The node as a T, or nullptr if it is of another kind.
+    template<typename T>
+    std::shared_ptr<const T> as() const {
+        if (!defined() || ptr->kind != T::node_kind) {
+            return nullptr;
+        }
+        return std::static_pointer_cast<const T>(ptr);
+    }
+
+    // Structural equality, since nodes are interned.
+    bool operator==(const Expr &other) const {
+        return ptr == other.ptr;
+    }
+
     // Forward a visitor to the underlying pointer.
     void accept(IRVisitor *) const;
 };
 
+// Hash for unordered containers of Exprs.
+struct ExprHash {
+    size_t operator()(const Expr &expr) const {
+        return expr.defined() ? expr.ptr->hash : 0;
+    }
+};
+
 // Supported operations on Exprs.
 Expr operator+(Expr a, Expr b);
 Expr operator*(Expr a, Expr b);
 
 // Represent an array read.
 struct ArrayRead : public ExprNode {
+    static constexpr ExprKind node_kind = ExprKind::ArrayRead;
     const Access access;
 
     ArrayRead(const Access &_access)
@@ -60,6 +96,7 @@ struct ArrayRead : public ExprNode {
 
 // Represent an addition.
 struct Add : public ExprNode {
+    static constexpr ExprKind node_kind = ExprKind::Add;
     Expr a, b;
 
     Add(Expr _a, Expr _b) : a(_a), b(_b) {}
@@ -71,6 +108,7 @@ struct Add : public ExprNode {
 
 // Represent a multiplication.
 struct Mul : public ExprNode {
+    static constexpr ExprKind node_kind = ExprKind::Mul;
     Expr a, b;
 
     Mul(Expr _a, Expr _b) : a(_a), b(_b) {}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <vector>
+
+#include "Array.h"
+
+// Fuse a pipeline of assignments into its last one, by substituting the
+// expression of every earlier assignment for the reads of its output. The
+// outputs of the earlier assignments are temporaries: the fused assignment
+// computes the same values without ever writing them, so its whole pipeline
+// lowers to a single merge lattice.
+Assignment fuse(const std::vector<Assignment> &pipeline);
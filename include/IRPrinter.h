@@ -15,6 +15,7 @@
  */
 
 #include <ostream>
+#include <set>
 #include <string>
 
 #include "Access.h"
@@ -62,6 +63,21 @@ struct IRPrinter : public IRVisitor {
     /** The stream on which we're outputting */
     std::ostream &stream;
 
+    /** Arrays whose values have been hoisted into __restrict locals
+     * by an enclosing ForStmt. */
+    std::set<std::string> hoisted;
+
+    /** Whether iterator bounds refer to the current partition of an
+     * enclosing PartitionedForStmt rather than to whole arrays. */
+    bool partitioned = false;
+
+    /** Emit the pragmas for a loop's scheduling hints. */
+    void print_loop_hints(const LIR::LoopHints &hints);
+
+    /** Emit the position range of the current partition of extent
+     * in each compressed operand. */
+    void print_located_bounds(const LIR::ArrayLevel &extent, const LIR::IteratorSet &compressed);
+
     /** Emit "(" */
     void open();
 
@@ -84,15 +100,33 @@ struct IRPrinter : public IRVisitor {
     // IndexStmt
     void visit(const ForAll *) override;
     void visit(const ArrayAssignment *) override;
+    void visit(const Multi *) override;
 
     // Lowered IR (LIR).
     void visit(const LIR::ArrayAccess *) override;
+    void visit(const LIR::Literal *) override;
+    void visit(const LIR::Var *) override;
+    void visit(const LIR::Select *) override;
+    void visit(const LIR::And *) override;
+    void visit(const LIR::Or *) override;
     void visit(const LIR::Add *) override;
     void visit(const LIR::Mul *) override;
     void visit(const LIR::SequenceStmt *) override;
+    void visit(const LIR::BlockStmt *) override;
     void visit(const LIR::WhileStmt *) override;
+    void visit(const LIR::ForStmt *) override;
     void visit(const LIR::IfStmt *) override;
+    void visit(const LIR::SwitchStmt *) override;
+    void visit(const LIR::VarDefinition *) override;
+    void visit(const LIR::KWayMergeStmt *) override;
+    void visit(const LIR::GallopStmt *) override;
+    void visit(const LIR::DenseLocateStmt *) override;
+    void visit(const LIR::DenseRunStmt *) override;
+    void visit(const LIR::InterleavedLoopStmt *) override;
+    void visit(const LIR::PartitionedForStmt *) override;
+    void visit(const LIR::ShardStmt *) override;
     void visit(const LIR::IncrementIterator *) override;
+    void visit(const LIR::IncrementCounter *) override;
     void visit(const LIR::CompressedIndexDefinition *) override;
     void visit(const LIR::LogicalIndexDefinition *) override;
     void visit(const LIR::IteratorDefinition *) override;
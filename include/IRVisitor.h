@@ -28,15 +28,33 @@ struct IRVisitor {
     // IndexStmt
     virtual void visit(const ForAll *);
     virtual void visit(const ArrayAssignment *);
+    virtual void visit(const Multi *);
 
     // Lowered IR (LIR).
     virtual void visit(const LIR::ArrayAccess *);
+    virtual void visit(const LIR::Literal *);
+    virtual void visit(const LIR::Var *);
+    virtual void visit(const LIR::Select *);
+    virtual void visit(const LIR::And *);
+    virtual void visit(const LIR::Or *);
     virtual void visit(const LIR::Add *);
     virtual void visit(const LIR::Mul *);
     virtual void visit(const LIR::SequenceStmt *);
+    virtual void visit(const LIR::BlockStmt *);
     virtual void visit(const LIR::WhileStmt *);
+    virtual void visit(const LIR::ForStmt *);
     virtual void visit(const LIR::IfStmt *);
+    virtual void visit(const LIR::SwitchStmt *);
+    virtual void visit(const LIR::VarDefinition *);
+    virtual void visit(const LIR::KWayMergeStmt *);
+    virtual void visit(const LIR::GallopStmt *);
+    virtual void visit(const LIR::DenseLocateStmt *);
+    virtual void visit(const LIR::DenseRunStmt *);
+    virtual void visit(const LIR::InterleavedLoopStmt *);
+    virtual void visit(const LIR::PartitionedForStmt *);
+    virtual void visit(const LIR::ShardStmt *);
     virtual void visit(const LIR::IncrementIterator *);
+    virtual void visit(const LIR::IncrementCounter *);
     virtual void visit(const LIR::CompressedIndexDefinition *);
     virtual void visit(const LIR::LogicalIndexDefinition *);
     virtual void visit(const LIR::IteratorDefinition *);
@@ -1,7 +1,10 @@
 #pragma once
 
+#include <cstdint>
 #include <memory>
+#include <string>
 #include <type_traits>
+#include <vector>
 
 #include "Access.h"
 #include "Expr.h"
@@ -18,7 +21,16 @@
 struct IRVisitor;
 
 
+// Kind tags of IndexStmt nodes (see IndexStmt::as).
+enum class IndexStmtKind {
+    ForAll,
+    ArrayAssignment,
+    Multi,
+};
+
 struct IndexStmtNode {
+    // Set by make().
+    IndexStmtKind kind;
     virtual void accept(IRVisitor *v) const = 0;
     IndexStmtNode() {}
     virtual ~IndexStmtNode() = default;
@@ -45,29 +57,85 @@ struct IndexStmt {
         return ptr != nullptr;
     }
 
+    // The node as a T, or nullptr if it is of another kind.
+    template<typename T>
+    std::shared_ptr<const T> as() const {
+        if (!defined() || ptr->kind != T::node_kind) {
+            return nullptr;
+        }
+        return std::static_pointer_cast<const T>(ptr);
+    }
+
     // Forward a visitor to the underlying pointer.
     void accept(IRVisitor *) const;
+
+    // Scheduling transformations, in the style of TACO. Each returns a new
+    // statement with the ForAll's Schedule updated; the statement must be a
+    // ForAll (e.g. from lower(Assignment)), and lower() honors the schedule.
+
+    // Strip-mine i into an outer loop i0 over blocks of factor coordinates
+    // and an inner loop i1 within each block.
+    IndexStmt split(const Index &i, const Index &i0, const Index &i1, const uint64_t factor) const;
+    // Strip-mine i in position space: blocks hold about factor nonzeros of
+    // operand, which must be compressed.
+    IndexStmt split_pos(const Index &i, const Access &operand, const Index &i0, const Index &i1, const uint64_t factor) const;
+    // Run the loop over i in parallel: i itself (one coordinate range per
+    // thread) or the outer loop of a split (one task per block).
+    IndexStmt parallelize(const Index &i) const;
+    // Vectorize the loop over i (or the inner loop of a split) with width lanes.
+    IndexStmt vectorize(const Index &i, const uint64_t width) const;
+    // Unroll the loop over i (or the inner loop of a split) factor times.
+    IndexStmt unroll(const Index &i, const uint64_t factor) const;
+    // Iterate loops over a single compressed operand as streams interleaved
+    // position streams, prefetching their dense gathers, so that cache
+    // misses overlap. Requires a dense output.
+    IndexStmt interleave(const Index &i, const uint64_t streams) const;
+};
+
+// Scheduling directives of a ForAll, set by the IndexStmt transformations.
+struct Schedule {
+    // Index variables of the outer and inner loops of a split, empty if the
+    // loop is not split.
+    std::string outer;
+    std::string inner;
+    // Coordinates (or nonzeros of position_operand) per block of a split.
+    uint64_t split_factor = 0;
+    // Compressed operand of a position-space split, empty for a coordinate split.
+    std::string position_operand;
+    // Index variable of the loop run in parallel, empty if sequential.
+    std::string parallel;
+    // Zero leaves these to the code generator and the C++ compiler.
+    uint64_t vectorize_width = 0;
+    uint64_t unroll_count = 0;
+    // Interleaved position streams, 0 to iterate positions in order.
+    uint64_t interleave_streams = 0;
 };
 
 
 // ForAll loop.
 struct ForAll : public IndexStmtNode {
+    static constexpr IndexStmtKind node_kind = IndexStmtKind::ForAll;
     // represents forall (sexpr) { body }
 
     // Set expression to loop over.
     SetExpr sexpr;
     // For this assignment, "body" will always be an ArrayAssignment (no nested for loops).
     IndexStmt body;
+    Schedule schedule;
 
     ForAll(SetExpr _sexpr, IndexStmt _body) : sexpr(_sexpr), body(_body) {}
+    ForAll(SetExpr _sexpr, IndexStmt _body, const Schedule &_schedule)
+        : sexpr(_sexpr), body(_body), schedule(_schedule) {}
     ~ForAll() override = default;
 
     static const std::shared_ptr<const ForAll> make(SetExpr _sexpr, IndexStmt _body);
+    static const std::shared_ptr<const ForAll> make(SetExpr _sexpr, IndexStmt _body, const Schedule &_schedule);
     void accept(IRVisitor *v) const override;
 };
 
 // Array assignment.
 struct ArrayAssignment : public IndexStmtNode {
+    static constexpr IndexStmtKind node_kind = IndexStmtKind::ArrayAssignment;
     // represents lhs = rhs
     Access lhs;
     Expr rhs;
@@ -79,3 +147,20 @@ struct ArrayAssignment : public IndexStmtNode {
     static const std::shared_ptr<const ArrayAssignment> make(const Access &_lhs, Expr _rhs);
     void accept(IRVisitor *v) const override;
 };
+
+// Several assignments evaluated at every point of one ForAll, e.g. outputs
+// computed from the same operands (horizontal fusion, see
+// lower(std::vector<Assignment>)). Each assignment is only evaluated at the
+// points of its own set expression.
+struct Multi : public IndexStmtNode {
+    static constexpr IndexStmtKind node_kind = IndexStmtKind::Multi;
+    // ArrayAssignments, in program order.
+    std::vector<IndexStmt> stmts;
+
+    Multi(const std::vector<IndexStmt> &_stmts)
+        : stmts(_stmts) {}
+    ~Multi() override = default;
+
+    static const std::shared_ptr<const Multi> make(const std::vector<IndexStmt> &_stmts);
+    void accept(IRVisitor *v) const override;
+};
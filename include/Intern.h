@@ -0,0 +1,91 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "Access.h"
+
+// Hash-consing of IR nodes. The make() factories of Expr and SetExpr nodes
+// look a node up by its structural key, and return the existing node if an
+// equal one is alive, so structurally equal nodes are a single object:
+// equality is a pointer compare, and every node carries an id and a
+// precomputed structural hash for ordered and hashed containers.
+
+// A node's kind, the array it reads (for leaves), and its operands' ids.
+struct InternKey {
+    int kind;
+    std::string name;
+    uint64_t a = 0;
+    uint64_t b = 0;
+
+    bool operator==(const InternKey &other) const {
+        return kind == other.kind && a == other.a && b == other.b && name == other.name;
+    }
+};
+
+// Name of a leaf that reads access, e.g. "B(i,)".
+inline std::string intern_name(const Access &access) {
+    std::string name = access.name + "(";
+    for (const auto &index : access.indices) {
+        name += index.name + ",";
+    }
+    return name + ")";
+}
+
+struct InternKeyHash {
+    size_t operator()(const InternKey &key) const {
+        size_t hash = std::hash<std::string>()(key.name);
+        for (const uint64_t part : {uint64_t(key.kind), key.a, key.b}) {
+            hash ^= std::hash<uint64_t>()(part) + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+        }
+        return hash;
+    }
+};
+
+// Interned nodes derived from Node, which must have id and hash members.
+template<typename Node>
+class InternTable {
+public:
+    // The live node with key, or a new one from create(), numbered in order
+    // of creation (ids start at 1, 0 stands for an undefined operand).
+    template<typename T>
+    std::shared_ptr<const T> get(const InternKey &key, const std::function<std::shared_ptr<T>()> &create) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = nodes.find(key);
+        if (it != nodes.end()) {
+            if (auto node = it->second.lock()) {
+                return std::static_pointer_cast<const T>(node);
+            }
+        }
+        std::shared_ptr<T> node = create();
+        node->id = next_id++;
+        node->hash = InternKeyHash()(key);
+        nodes[key] = node;
+        if (nodes.size() >= prune_size) {
+            prune();
+        }
+        return node;
+    }
+
+private:
+    // Drop the entries of dead nodes, which keep their memory from being
+    // released.
+    void prune() {
+        for (auto it = nodes.begin(); it != nodes.end();) {
+            it = it->second.expired() ? nodes.erase(it) : std::next(it);
+        }
+        prune_size = std::max<size_t>(1024, 2 * nodes.size());
+    }
+
+    std::mutex mutex;
+    // Dead nodes are replaced when an equal node is made again.
+    std::unordered_map<InternKey, std::weak_ptr<const Node>, InternKeyHash> nodes;
+    size_t prune_size = 1024;
+    uint64_t next_id = 1;
+};
@@ -1,11 +1,22 @@
 #pragma once
 
+#include <map>
 #include <string>
 #include <vector>
 
 #include "Array.h"
+#include "CostModel.h"
+#include "IndexStmt.h"
 #include "LIR.h"
+#include "Profile.h"
 #include "Format.h"
+#include "TaskGraph.h"
+
+// The arrays of the kernel of stmt, output first, as kernel() takes them.
+std::vector<std::string> get_arg_list(const IndexStmt &stmt, const FormatMap &formats);
+
+// Creates an empty temporary file, and returns its name. Requires POSIX.
+std::string make_temporary_file();
 
 // Performs full lowering + compilation into a file.
 void compile(const Assignment &assignment, const FormatMap &formats, const std::string &filename);
@@ -14,10 +25,101 @@ void compile(const Assignment &assignment, const FormatMap &formats, const std::
 // Compiles into a temporary file and runs the corresponding test.
 void compile_and_test(const Assignment &assignment, const FormatMap &formats, const std::string &test_file);
 
+// As compile, also emitting kernel_batch(uint64_t K, array &...), which
+// evaluates the kernel over K stacked vectors (see runtime/batch.h) in one
+// call.
+void compile_batched(const Assignment &assignment, const FormatMap &formats, const std::string &filename);
+void compile_batched_and_test(const Assignment &assignment, const FormatMap &formats, const std::string &test_file);
+
+// As compile, also emitting kernel_shard(i_part_begin, i_part_end,
+// array &...), which only computes the given range of the output, and
+// kernel_sharded(uint64_t P, array &...), which runs it over P worker
+// processes (see runtime/shard.h) and returns the number of failed shards.
+// The outputs must be dense. Sharded kernels require POSIX shared memory.
+void compile_sharded(const Assignment &assignment, const FormatMap &formats, const std::string &filename);
+void compile_sharded_and_test(const Assignment &assignment, const FormatMap &formats, const std::string &test_file);
+
+// As above, lowered with the strategy the cost model expects to be cheapest
+// on operands with stats (see choose_strategy in Lower.h).
+void compile(const Assignment &assignment, const FormatMap &formats, const OperandStatsMap &stats, const std::string &filename);
+void compile_and_test(const Assignment &assignment, const FormatMap &formats, const OperandStatsMap &stats, const std::string &test_file);
+
+
+// Compiles every variant of the kernel of assignment (see lower_variants in
+// Lower.h) into one file, as kernel_merge, kernel_dense_locate and
+// kernel_gallop_<operand>. kernel(array &...) is a prologue that estimates
+// the cost of each variant from the operands' pos[1] - pos[0] and the
+// output's shape[0] (see runtime/versioning.h) and runs the cheapest, so the
+// kernel adapts to the sparsity of each call without being recompiled.
+// With a single variant, this is compile.
+void compile_versioned(const Assignment &assignment, const FormatMap &formats, const std::string &filename);
+void compile_versioned_and_test(const Assignment &assignment, const FormatMap &formats, const std::string &test_file);
+
+
+// Compiles a training kernel for assignment: kernel(array &...) counts how
+// often each case of its lattice loops is taken (see lower_instrumented in
+// Lower.h), and the counts are appended to profile_file when the program
+// exits, to be read by read_branch_profile (see Profile.h). Counts of runs
+// add up. Only kernel() is emitted.
+void compile_instrumented(const Assignment &assignment, const FormatMap &formats, const std::string &profile_file,
+                          const std::string &filename);
+void compile_instrumented_and_test(const Assignment &assignment, const FormatMap &formats, const std::string &profile_file,
+                                   const std::string &test_file);
+
+// As compile, with the cases of lattice loops ordered and hinted by profile
+// (see lower(IndexStmt, FormatMap, BranchProfile) in Lower.h).
+void compile(const Assignment &assignment, const FormatMap &formats, const BranchProfile &profile, const std::string &filename);
+void compile_and_test(const Assignment &assignment, const FormatMap &formats, const BranchProfile &profile, const std::string &test_file);
+
+// A kernel compiled by compile_cached: the file it is in, and the arrays
+// kernel() takes.
+struct CachedKernel {
+    std::string filename;
+    std::vector<std::string> arg_list;
+};
+
+// Kernels compiled so far, by kernel_cache_key.
+struct KernelCache {
+    std::map<std::string, CachedKernel> kernels;
+};
+
+// Compiles the canonical form of assignment (see Canonicalize.h) into a
+// temporary file, unless an equivalent assignment is already in cache.
+// Equivalent assignments share the kernel, so its arguments are in the
+// order of the canonical form rather than of assignment.
+const CachedKernel &compile_cached(KernelCache &cache, const Assignment &assignment, const FormatMap &formats);
+
+// Compiles assignments to different outputs into one kernel that computes
+// them all in a single pass over their operands (see lower(std::vector<Assignment>)).
+// Its arguments are the arrays of the assignments, in order of first use.
+void compile(const std::vector<Assignment> &assignments, const FormatMap &formats, const std::string &filename);
+
+// Compiles assignments into one kernel in a temporary file and runs the
+// corresponding test.
+void compile_and_test(const std::vector<Assignment> &assignments, const FormatMap &formats, const std::string &test_file);
+
+// As compile_sharded, for assignments fused into one kernel.
+void compile_sharded(const std::vector<Assignment> &assignments, const FormatMap &formats, const std::string &filename);
+void compile_sharded_and_test(const std::vector<Assignment> &assignments, const FormatMap &formats, const std::string &test_file);
 
 // Helper method, compile stmt into the corresponding file.
 void compile_to_file(const LIR::Stmt &stmt, const std::vector<std::string> &arg_list, const std::string &filename);
 
+// As compile_to_file, also emitting kernel_batch (see compile_batched) or
+// kernel_shard and kernel_sharded (see compile_sharded). stmt must be
+// sequential.
+void compile_batched_to_file(const LIR::Stmt &stmt, const std::vector<std::string> &arg_list, const std::string &filename);
+void compile_sharded_to_file(const LIR::Stmt &stmt, const std::vector<std::string> &arg_list, const std::string &filename);
+
 // Helper method, compile stmt into a kernel and run the test in `test_file`
 void compile_and_test(const LIR::Stmt &stmt, const std::vector<std::string> &arg_list, const std::string &test_file);
+void compile_sharded_and_test(const LIR::Stmt &stmt, const std::vector<std::string> &arg_list, const std::string &test_file);
+
+// Compiles every assignment of graph into one file, as kernel_0, kernel_1, ...
+// and kernel_graph(array &...) over every array they use (in order of first
+// use), which runs them as a task graph (see runtime/graph.h): independent
+// assignments run concurrently on the kernel thread pool.
+void compile_graph(const TaskGraph &graph, const FormatMap &formats, const std::string &filename);
 
+// Compiles graph into a temporary file and runs the corresponding test.
+void compile_and_test(const TaskGraph &graph, const FormatMap &formats, const std::string &test_file);
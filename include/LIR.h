@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <cassert>
 #include <cstdint>
 #include <memory>
@@ -8,6 +9,7 @@
 
 #include "Access.h"
 #include "Format.h"
+#include "Symbol.h"
 
 
 // An imperative C-like IR that IndexStmts can be lowered to.
@@ -20,7 +22,22 @@ struct IRVisitor;
 namespace LIR {
 
 // Expressions in the lowered IR.
+
+// Kind tags of Expr nodes, for dispatch without dynamic casts (see Expr::as).
+enum class ExprKind {
+    ArrayAccess,
+    Literal,
+    Var,
+    Select,
+    And,
+    Or,
+    Add,
+    Mul,
+};
+
 struct ExprNode {
+    // Set by make().
+    ExprKind kind;
     virtual void accept(IRVisitor *v) const = 0;
     ExprNode() {}
     virtual ~ExprNode() = default;
@@ -50,13 +67,22 @@ struct Expr {
         return ptr != nullptr;
     }
 
+    // The node as a T, or nullptr if it is of another kind.
+    template<typename T>
+    std::shared_ptr<const T> as() const {
+        if (!defined() || ptr->kind != T::node_kind) {
+            return nullptr;
+        }
+        return std::static_pointer_cast<const T>(ptr);
+    }
+
     // Forward a visitor to the underlying pointer.
     void accept(IRVisitor *) const;
 };
 
 struct ArrayLevel {
     // Which array and which dimension this refers to.
-    std::string name;
+    Symbol name;
     // Whether this is a dense or compressed level.
     Format format;
 };
@@ -65,6 +91,7 @@ LIR::ArrayLevel access_to_array_level(const Access &access, const FormatMap &for
 
 // Read a value from an array.
 struct ArrayAccess : public ExprNode {
+    static constexpr ExprKind node_kind = ExprKind::ArrayAccess;
     // Which array level this refers to.
     const ArrayLevel array;
 
@@ -76,7 +103,77 @@ struct ArrayAccess : public ExprNode {
     void accept(IRVisitor *v) const override;
 };
 
+// A floating-point constant.
+struct Literal : public ExprNode {
+    static constexpr ExprKind node_kind = ExprKind::Literal;
+    const float value;
+
+    Literal(const float _value)
+        : value(_value) {}
+    ~Literal() override = default;
+
+    static const std::shared_ptr<const Literal> make(const float _value);
+    void accept(IRVisitor *v) const override;
+};
+
+// A named scalar local, e.g. a flag or a value computed earlier in the kernel.
+struct Var : public ExprNode {
+    static constexpr ExprKind node_kind = ExprKind::Var;
+    const std::string name;
+
+    Var(const std::string &_name)
+        : name(_name) {}
+    ~Var() override = default;
+
+    static const std::shared_ptr<const Var> make(const std::string &_name);
+    void accept(IRVisitor *v) const override;
+};
+
+// Represents:
+// (cond ? a : b)
+// Only the selected operand is evaluated.
+struct Select : public ExprNode {
+    static constexpr ExprKind node_kind = ExprKind::Select;
+    const Expr cond, a, b;
+
+    Select(const Expr &_cond, const Expr &_a, const Expr &_b) : cond(_cond), a(_a), b(_b) {
+        assert(cond.defined() && a.defined() && b.defined());
+    }
+    ~Select() override = default;
+
+    static const std::shared_ptr<const Select> make(const Expr &_cond, const Expr &_a, const Expr &_b);
+    void accept(IRVisitor *v) const override;
+};
+
+// Logical and/or of two boolean expressions.
+struct And : public ExprNode {
+    static constexpr ExprKind node_kind = ExprKind::And;
+    const Expr a, b;
+
+    And(const Expr &_a, const Expr &_b) : a(_a), b(_b) {
+        assert(a.defined() && b.defined());
+    }
+    ~And() override = default;
+
+    static const std::shared_ptr<const And> make(const Expr &_a, const Expr &_b);
+    void accept(IRVisitor *v) const override;
+};
+
+struct Or : public ExprNode {
+    static constexpr ExprKind node_kind = ExprKind::Or;
+    const Expr a, b;
+
+    Or(const Expr &_a, const Expr &_b) : a(_a), b(_b) {
+        assert(a.defined() && b.defined());
+    }
+    ~Or() override = default;
+
+    static const std::shared_ptr<const Or> make(const Expr &_a, const Expr &_b);
+    void accept(IRVisitor *v) const override;
+};
+
 struct Add : public ExprNode {
+    static constexpr ExprKind node_kind = ExprKind::Add;
     const Expr a, b;
 
     Add(const Expr &_a, const Expr &_b) : a(_a), b(_b) {
@@ -89,6 +186,7 @@ struct Add : public ExprNode {
 };
 
 struct Mul : public ExprNode {
+    static constexpr ExprKind node_kind = ExprKind::Mul;
     const Expr a, b;
 
     Mul(const Expr &_a, const Expr &_b) : a(_a), b(_b) {
@@ -102,7 +200,33 @@ struct Mul : public ExprNode {
 
 
 // Statements in the lowered IR.
+// Kind tags of Stmt nodes (see Stmt::as).
+enum class StmtKind {
+    SequenceStmt,
+    BlockStmt,
+    WhileStmt,
+    ForStmt,
+    IfStmt,
+    SwitchStmt,
+    VarDefinition,
+    KWayMergeStmt,
+    GallopStmt,
+    DenseLocateStmt,
+    DenseRunStmt,
+    InterleavedLoopStmt,
+    PartitionedForStmt,
+    ShardStmt,
+    IncrementIterator,
+    IncrementCounter,
+    CompressedIndexDefinition,
+    LogicalIndexDefinition,
+    IteratorDefinition,
+    ArrayAssignment,
+};
+
 struct StmtNode {
+    // Set by make().
+    StmtKind kind;
     virtual void accept(IRVisitor *v) const = 0;
     StmtNode() {}
     virtual ~StmtNode() = default;
@@ -129,6 +253,15 @@ struct Stmt {
         return ptr != nullptr;
     }
 
+    // The node as a T, or nullptr if it is of another kind.
+    template<typename T>
+    std::shared_ptr<const T> as() const {
+        if (!defined() || ptr->kind != T::node_kind) {
+            return nullptr;
+        }
+        return std::static_pointer_cast<const T>(ptr);
+    }
+
     // Forward a visitor to the underlying pointer.
     void accept(IRVisitor *) const;
 };
@@ -138,6 +271,7 @@ struct Stmt {
 // stmt[1]
 // ...
 struct SequenceStmt : public StmtNode {
+    static constexpr StmtKind node_kind = StmtKind::SequenceStmt;
     const std::vector<Stmt> stmts;
 
     SequenceStmt(const std::vector<Stmt> _stmts)
@@ -148,45 +282,131 @@ struct SequenceStmt : public StmtNode {
     void accept(IRVisitor *v) const override;
 };
 
+// Represents:
+// {
+//   body;
+// }
+// Useful for reusing iterator names across independent loops.
+struct BlockStmt : public StmtNode {
+    static constexpr StmtKind node_kind = StmtKind::BlockStmt;
+    const Stmt body;
+
+    BlockStmt(const Stmt &_body)
+        : body(_body) {
+        assert(body.defined());
+    }
+    ~BlockStmt() override = default;
+
+    static const std::shared_ptr<const BlockStmt> make(const Stmt &_body);
+    void accept(IRVisitor *v) const override;
+};
+
 struct IteratorSet {
     const std::vector<ArrayLevel> iterators;
 };
 
 // Generates:
 // while(condition) { body; }
+// Code generation hints for a loop, from the ForAll's Schedule. Zero leaves
+// the choice to the C++ compiler.
+struct LoopHints {
+    uint64_t vectorize_width = 0;
+    uint64_t unroll_count = 0;
+};
+
 struct WhileStmt : public StmtNode {
+    static constexpr StmtKind node_kind = StmtKind::WhileStmt;
     // Represents a condition that all of the given iterators are valid.
     // i.e. for iterators a (Dense) and b (Compressed)
     // (a_i < a_i_max) && (b_i_iter < b_i_iter_max)
     const IteratorSet condition;
     const Stmt body;
+    const LoopHints hints;
 
     WhileStmt(const IteratorSet &_condition, const Stmt &_body)
         : condition(_condition), body(_body) {
         assert(body.defined());
     }
+    WhileStmt(const IteratorSet &_condition, const Stmt &_body, const LoopHints &_hints)
+        : condition(_condition), body(_body), hints(_hints) {
+        assert(body.defined());
+    }
     ~WhileStmt() override = default;
 
     static const std::shared_ptr<const WhileStmt> make(const IteratorSet &_condition, const Stmt &_body);
+    static const std::shared_ptr<const WhileStmt> make(const IteratorSet &_condition, const Stmt &_body, const LoopHints &_hints);
     void accept(IRVisitor *v) const override;
 };
 
+// Generates a counted loop over the logical index, for lattice points where
+// every operand is dense. Values of each array are hoisted into
+// __restrict-qualified locals so the C compiler can vectorize the loop:
+// float *__restrict a_vals = a.values;
+// ...
+// for (uint64_t i = 0; i < bound.shape[0]; i++) { body; }
+struct ForStmt : public StmtNode {
+    static constexpr StmtKind node_kind = StmtKind::ForStmt;
+    // Dense level whose extent bounds the loop.
+    const ArrayLevel bound;
+    // Dense arrays accessed through hoisted value pointers.
+    const IteratorSet arrays;
+    const Stmt body;
+    const LoopHints hints;
+
+    ForStmt(const ArrayLevel &_bound, const IteratorSet &_arrays, const Stmt &_body)
+        : ForStmt(_bound, _arrays, _body, LoopHints{}) {
+    }
+    ForStmt(const ArrayLevel &_bound, const IteratorSet &_arrays, const Stmt &_body, const LoopHints &_hints)
+        : bound(_bound), arrays(_arrays), body(_body), hints(_hints) {
+        assert(bound.format == Format::Dense);
+        for (const auto &array : arrays.iterators) {
+            assert(array.format == Format::Dense);
+        }
+        assert(body.defined());
+    }
+    ~ForStmt() override = default;
+
+    static const std::shared_ptr<const ForStmt> make(const ArrayLevel &_bound, const IteratorSet &_arrays, const Stmt &_body);
+    static const std::shared_ptr<const ForStmt> make(const ArrayLevel &_bound, const IteratorSet &_arrays, const Stmt &_body, const LoopHints &_hints);
+    void accept(IRVisitor *v) const override;
+};
+
+// How often a case of an IfStmt is expected to be taken, from a profile (see
+// Profile.h).
+enum class BranchHint {
+    None,
+    // Wrapped in __builtin_expect(..., 1).
+    Likely,
+    // Wrapped in __builtin_expect(..., 0).
+    Unlikely,
+    // Unlikely, and the body is moved out of line, into a lambda that is
+    // never inlined, to keep the hot path compact.
+    Cold,
+};
+
 // Generates:
 // if (conditions[0]) { bodies[0]; }
 // else if (conditions[1]) { bodies[1]; }
 // ...
 // else if (conditions.last()) { bodies.last(); }
 struct IfStmt : public StmtNode {
+    static constexpr StmtKind node_kind = StmtKind::IfStmt;
     // Represents a condition that all of the given iterators match the logical index.
     // i.e. for iterators a, b, c:
     // (a_i == i) && (b_i == i) && (c_i == i)
     const std::vector<IteratorSet> conditions;
     // Bodies of each of the if statements.
     const std::vector<Stmt> bodies;
+    // Hint for each condition, or empty for none.
+    const std::vector<BranchHint> hints;
 
     IfStmt(const std::vector<IteratorSet> &_conditions, const std::vector<Stmt> _bodies)
-        : conditions(_conditions), bodies(_bodies) {
+        : IfStmt(_conditions, _bodies, {}) {
+    }
+    IfStmt(const std::vector<IteratorSet> &_conditions, const std::vector<Stmt> _bodies, const std::vector<BranchHint> &_hints)
+        : conditions(_conditions), bodies(_bodies), hints(_hints) {
         assert(conditions.size() == bodies.size());
+        assert(hints.empty() || hints.size() == conditions.size());
         for (const auto &body : bodies) {
             assert(body.defined());
         }
@@ -194,6 +414,384 @@ struct IfStmt : public StmtNode {
     ~IfStmt() override = default;
 
     static const std::shared_ptr<const IfStmt> make(const std::vector<IteratorSet> &_conditions, const std::vector<Stmt> _bodies);
+    static const std::shared_ptr<const IfStmt> make(const std::vector<IteratorSet> &_conditions, const std::vector<Stmt> _bodies,
+                                                    const std::vector<BranchHint> &_hints);
+    void accept(IRVisitor *v) const override;
+};
+
+// Generates:
+// uint64_t i_mask = ((uint64_t)(iterators[0]_i == i) << 0) | ((uint64_t)(iterators[1]_i == i) << 1) | ...;
+// switch (i_mask) {
+//   case cases[0][0]:
+//   case cases[0][1]: { bodies[0]; break; }
+//   ...
+// }
+// An alternative to IfStmt that dispatches on which iterators match the
+// logical index with one comparison per iterator.
+struct SwitchStmt : public StmtNode {
+    static constexpr StmtKind node_kind = StmtKind::SwitchStmt;
+    // Iterators whose match against the logical index forms bit n of the mask.
+    const IteratorSet iterators;
+    // Mask values that select each body.
+    const std::vector<std::vector<uint64_t>> cases;
+    const std::vector<Stmt> bodies;
+
+    SwitchStmt(const IteratorSet &_iterators, const std::vector<std::vector<uint64_t>> &_cases, const std::vector<Stmt> &_bodies)
+        : iterators(_iterators), cases(_cases), bodies(_bodies) {
+        assert(iterators.iterators.size() < 64);
+        assert(cases.size() == bodies.size());
+        for (const auto &body : bodies) {
+            assert(body.defined());
+        }
+    }
+    ~SwitchStmt() override = default;
+
+    static const std::shared_ptr<const SwitchStmt> make(const IteratorSet &_iterators, const std::vector<std::vector<uint64_t>> &_cases, const std::vector<Stmt> &_bodies);
+    void accept(IRVisitor *v) const override;
+};
+
+// Type of a scalar local.
+enum class ScalarType {
+    Bool,
+    Float,
+};
+
+// Represents:
+//  const float name = value;
+// or, for ScalarType::Bool:
+//  const bool name = value;
+struct VarDefinition : public StmtNode {
+    static constexpr StmtKind node_kind = StmtKind::VarDefinition;
+    const std::string name;
+    const ScalarType type;
+    const Expr value;
+
+    VarDefinition(const std::string &_name, const ScalarType _type, const Expr &_value)
+        : name(_name), type(_type), value(_value) {
+        assert(value.defined());
+    }
+    ~VarDefinition() override = default;
+
+    static const std::shared_ptr<const VarDefinition> make(const std::string &_name, const ScalarType _type, const Expr &_value);
+    void accept(IRVisitor *v) const override;
+};
+
+// Co-iterates many compressed iterators with a k-way merge over a min-heap
+// (see runtime/merge.h) instead of min() over every iterator. Each step pops
+// the smallest coordinate and advances only the iterators positioned at it.
+// Generates:
+// while (heap is not empty) {
+//   uint64_t i = smallest coordinate;
+//   advance iterators at i;
+//   bool a_present = (a_i == i);
+//   uint64_t a_i_iter = position of a at i;
+//   ...
+//   definitions;
+//   if (guard) { body; }
+// }
+struct KWayMergeStmt : public StmtNode {
+    static constexpr StmtKind node_kind = StmtKind::KWayMergeStmt;
+    // Compressed iterators to merge.
+    const IteratorSet iterators;
+    // Locals computed at every step, in terms of the iterators'
+    // <name>_present flags.
+    const Stmt definitions;
+    // Whether the body applies at the current coordinate.
+    const Expr guard;
+    const Stmt body;
+
+    KWayMergeStmt(const IteratorSet &_iterators, const Stmt &_definitions, const Expr &_guard, const Stmt &_body)
+        : iterators(_iterators), definitions(_definitions), guard(_guard), body(_body) {
+        assert(!iterators.iterators.empty());
+        for (const auto &iter : iterators.iterators) {
+            assert(iter.format == Format::Compressed);
+        }
+        assert(definitions.defined() && guard.defined() && body.defined());
+    }
+    ~KWayMergeStmt() override = default;
+
+    static const std::shared_ptr<const KWayMergeStmt> make(const IteratorSet &_iterators, const Stmt &_definitions, const Expr &_guard, const Stmt &_body);
+    void accept(IRVisitor *v) const override;
+};
+
+// Intersects compressed iterators by walking lead one position at a time
+// and galloping every other iterator forward to lead's coordinate (see
+// gallop in runtime/merge.h), so each of them costs time logarithmic in the
+// distance it skips rather than linear. Cheapest when lead has far fewer
+// nonzeros than the others. The loop ends when any iterator runs out.
+// Generates:
+// while (b_i_iter < b.pos[1]) {
+//   uint64_t b_i = b.crd[b_i_iter];
+//   uint64_t i = b_i;
+//   c_i_iter = gallop(c.crd, c_i_iter, c.pos[1], i);
+//   if (c_i_iter == c.pos[1]) break;
+//   uint64_t c_i = c.crd[c_i_iter];
+//   ...
+//   if ((c_i == i) && ...) { body; }
+//   b_i_iter++;
+// }
+struct GallopStmt : public StmtNode {
+    static constexpr StmtKind node_kind = StmtKind::GallopStmt;
+    // Iterator walked one position at a time.
+    const ArrayLevel lead;
+    // Iterators galloped to lead's coordinates.
+    const IteratorSet others;
+    // Applied where every iterator is present.
+    const Stmt body;
+
+    GallopStmt(const ArrayLevel &_lead, const IteratorSet &_others, const Stmt &_body)
+        : lead(_lead), others(_others), body(_body) {
+        assert(lead.format == Format::Compressed);
+        assert(!others.iterators.empty());
+        for (const auto &iter : others.iterators) {
+            assert(iter.format == Format::Compressed);
+        }
+        assert(body.defined());
+    }
+    ~GallopStmt() override = default;
+
+    static const std::shared_ptr<const GallopStmt> make(const ArrayLevel &_lead, const IteratorSet &_others, const Stmt &_body);
+    void accept(IRVisitor *v) const override;
+};
+
+// Visits every coordinate of a dense level in a counted loop, and locates
+// each compressed iterator at it with a cursor that only moves forward,
+// instead of co-iterating the iterators. Every coordinate costs a step, but
+// a step has no min() and no chain of branches on which iterators match, so
+// this is cheapest when the compressed iterators are nearly full.
+// Generates:
+// for (uint64_t i = 0; i < bound.shape[0]; i++) {
+//   const bool b_present = (b_i_iter < b.pos[1]) && (b.crd[b_i_iter] == i);
+//   ...
+//   definitions;
+//   if (guard) { body; }
+//   b_i_iter += b_present;
+//   ...
+// }
+struct DenseLocateStmt : public StmtNode {
+    static constexpr StmtKind node_kind = StmtKind::DenseLocateStmt;
+    // Dense level whose coordinates are visited.
+    const ArrayLevel bound;
+    // Compressed iterators to locate.
+    const IteratorSet iterators;
+    // Locals computed at every coordinate, in terms of the iterators'
+    // <name>_present flags.
+    const Stmt definitions;
+    // Whether the body applies at the current coordinate.
+    const Expr guard;
+    const Stmt body;
+
+    DenseLocateStmt(const ArrayLevel &_bound, const IteratorSet &_iterators, const Stmt &_definitions, const Expr &_guard, const Stmt &_body)
+        : bound(_bound), iterators(_iterators), definitions(_definitions), guard(_guard), body(_body) {
+        assert(bound.format == Format::Dense);
+        for (const auto &iter : iterators.iterators) {
+            assert(iter.format == Format::Compressed);
+        }
+        assert(definitions.defined() && guard.defined() && body.defined());
+    }
+    ~DenseLocateStmt() override = default;
+
+    static const std::shared_ptr<const DenseLocateStmt> make(const ArrayLevel &_bound, const IteratorSet &_iterators, const Stmt &_definitions,
+                                                             const Expr &_guard, const Stmt &_body);
+    void accept(IRVisitor *v) const override;
+};
+
+// Loop versioning for runs of consecutive coordinates in compressed
+// iterators. When every iterator is at the start of a run of at least width
+// coordinates, and all runs start at the same coordinate, the body is applied
+// to the whole block in a counted loop the C compiler can vectorize.
+// Generates:
+// if ((a_i_iter + width <= a.pos[1]) && (a.crd[a_i_iter + width - 1] - a.crd[a_i_iter] == width - 1) &&
+//     ... && (b.crd[b_i_iter] == a.crd[a_i_iter])) {
+//   for (uint64_t i_offset = 0; i_offset < width; i_offset++) {
+//     const uint64_t i = a.crd[a_i_iter] + i_offset;
+//     const uint64_t a_i_iter = ... + i_offset;
+//     body;
+//   }
+//   a_i_iter += width;
+//   ...
+//   continue;
+// }
+struct DenseRunStmt : public StmtNode {
+    static constexpr StmtKind node_kind = StmtKind::DenseRunStmt;
+    const IteratorSet iterators;
+    const uint64_t width;
+    // Applied at every coordinate of the run, with all iterators present.
+    const Stmt body;
+
+    DenseRunStmt(const IteratorSet &_iterators, const uint64_t _width, const Stmt &_body)
+        : iterators(_iterators), width(_width), body(_body) {
+        assert(!iterators.iterators.empty());
+        for (const auto &iter : iterators.iterators) {
+            assert(iter.format == Format::Compressed);
+        }
+        assert(width > 1);
+        assert(body.defined());
+    }
+    ~DenseRunStmt() override = default;
+
+    static const std::shared_ptr<const DenseRunStmt> make(const IteratorSet &_iterators, const uint64_t _width, const Stmt &_body);
+    void accept(IRVisitor *v) const override;
+};
+
+// Iterates a single compressed iterator, from its current position to its
+// bound, as streams interleaved position streams visited round-robin
+// (asynchronous memory access chaining). Each step prefetches the dense
+// arrays gathered at the coordinate distance positions ahead in the same
+// stream, so the cache misses of different streams overlap. Positions may be
+// visited in any order, so body must write a dense output. Generates:
+// split [b_i_iter, b_i_iter_end) into streams equal ranges
+// for (bool i_active = true; i_active;) {
+//   i_active = false;
+//   for (uint64_t i_stream = 0; i_stream < streams; i_stream++) {
+//     const uint64_t b_i_iter = b_i_iter_streams[i_stream];
+//     if (b_i_iter < b_i_iter_stream_ends[i_stream]) {
+//       i_active = true;
+//       prefetch c.values[b.crd[b_i_iter + distance]], ...
+//       body;
+//       b_i_iter_streams[i_stream]++;
+//     }
+//   }
+// }
+// b_i_iter = b_i_iter_end;
+struct InterleavedLoopStmt : public StmtNode {
+    static constexpr StmtKind node_kind = StmtKind::InterleavedLoopStmt;
+    const ArrayLevel iterator;
+    const uint64_t streams;
+    const uint64_t distance;
+    // Dense arrays accessed at the iterator's coordinates.
+    const IteratorSet gathered;
+    const Stmt body;
+
+    InterleavedLoopStmt(const ArrayLevel &_iterator, const uint64_t _streams, const uint64_t _distance,
+                        const IteratorSet &_gathered, const Stmt &_body)
+        : iterator(_iterator), streams(_streams), distance(_distance), gathered(_gathered), body(_body) {
+        assert(iterator.format == Format::Compressed);
+        assert(streams > 1);
+        for (const auto &array : gathered.iterators) {
+            assert(array.format == Format::Dense);
+        }
+        assert(body.defined());
+    }
+    ~InterleavedLoopStmt() override = default;
+
+    static const std::shared_ptr<const InterleavedLoopStmt> make(const ArrayLevel &_iterator, const uint64_t _streams, const uint64_t _distance,
+                                                                 const IteratorSet &_gathered, const Stmt &_body);
+    void accept(IRVisitor *v) const override;
+};
+
+// How a PartitionedForStmt splits the coordinate space into partitions.
+enum class Partitioning {
+    // Equal coordinate ranges: one per thread of the pool (range t always on
+    // thread t, see runtime/numa.h), or blocks of grain coordinates (a
+    // strip-mined loop).
+    Coordinates,
+    // Chunks of about grain nonzeros of one compressed operand (a
+    // position-space split); in parallel, run by a work-stealing scheduler
+    // (see runtime/scheduler.h).
+    Nonzeros,
+};
+
+// Runs body once per partition of the coordinate space [0, extent.shape[0]),
+// in parallel on the runtime thread pool (see runtime/parallel.h) or in order.
+// Every partition locates its position range in each compressed operand by
+// binary search over crd, and body's loops are bounded by those ranges.
+// Parallel partitions must write disjoint parts of the output.
+// With Partitioning::Coordinates and no grain, generates:
+// pool.parallel_for_each_thread([&](const uint64_t part) {
+//   const uint64_t i_part_begin = partition_bound(extent.shape[0], part, parts);
+//   const uint64_t i_part_end = partition_bound(extent.shape[0], part + 1, parts);
+//   const uint64_t b_i_iter_part_begin = locate(b, i_part_begin);
+//   const uint64_t b_i_iter_part_end = locate(b, i_part_end);
+//   ...
+//   body;
+// });
+// With a grain, partitions are blocks of grain coordinates (block_bound), and
+// with Partitioning::Nonzeros blocks of grain nonzeros of position_operand:
+// const array *position_operand = the operand (or the one with the most nonzeros);
+// const uint64_t parts = balanced_chunk_count(position_operand, extent.shape[0], grain);
+// run_balanced(parts, [&](const uint64_t part) {
+//   const uint64_t i_part_begin = balanced_chunk_bound(position_operand, extent.shape[0], part, parts);
+//   ...
+// });
+// Sequential partitions run in a plain for loop over part instead.
+struct PartitionedForStmt : public StmtNode {
+    static constexpr StmtKind node_kind = StmtKind::PartitionedForStmt;
+    // Dense level whose extent is partitioned.
+    const ArrayLevel extent;
+    // Compressed operands to locate partition bounds in.
+    const IteratorSet compressed;
+    const Stmt body;
+    const Partitioning partitioning;
+    // Coordinates or nonzeros per partition, 0 for one partition per thread
+    // (Partitioning::Coordinates only).
+    const uint64_t grain;
+    // Name of the compressed operand whose nonzeros Partitioning::Nonzeros
+    // splits, empty for the one with the most nonzeros at run time.
+    const std::string position_operand;
+    const bool parallel;
+
+    PartitionedForStmt(const ArrayLevel &_extent, const IteratorSet &_compressed, const Stmt &_body)
+        : PartitionedForStmt(_extent, _compressed, _body, Partitioning::Coordinates, 0) {
+    }
+    PartitionedForStmt(const ArrayLevel &_extent, const IteratorSet &_compressed, const Stmt &_body,
+                       const Partitioning _partitioning, const uint64_t _grain)
+        : PartitionedForStmt(_extent, _compressed, _body, _partitioning, _grain, "", true) {
+    }
+    PartitionedForStmt(const ArrayLevel &_extent, const IteratorSet &_compressed, const Stmt &_body,
+                       const Partitioning _partitioning, const uint64_t _grain,
+                       const std::string &_position_operand, const bool _parallel)
+        : extent(_extent), compressed(_compressed), body(_body), partitioning(_partitioning), grain(_grain),
+          position_operand(_position_operand), parallel(_parallel) {
+        assert(extent.format == Format::Dense);
+        for (const auto &iter : compressed.iterators) {
+            assert(iter.format == Format::Compressed);
+        }
+        assert(body.defined());
+        assert(grain > 0 || (partitioning == Partitioning::Coordinates && parallel));
+        assert(position_operand.empty() || partitioning == Partitioning::Nonzeros);
+        assert(position_operand.empty() ||
+               std::any_of(compressed.iterators.cbegin(), compressed.iterators.cend(),
+                           [&](const ArrayLevel &iter) { return iter.name == position_operand; }));
+    }
+    ~PartitionedForStmt() override = default;
+
+    static const std::shared_ptr<const PartitionedForStmt> make(const ArrayLevel &_extent, const IteratorSet &_compressed, const Stmt &_body);
+    static const std::shared_ptr<const PartitionedForStmt> make(const ArrayLevel &_extent, const IteratorSet &_compressed, const Stmt &_body,
+                                                                const Partitioning _partitioning, const uint64_t _grain);
+    static const std::shared_ptr<const PartitionedForStmt> make(const ArrayLevel &_extent, const IteratorSet &_compressed, const Stmt &_body,
+                                                                const Partitioning _partitioning, const uint64_t _grain,
+                                                                const std::string &_position_operand, const bool _parallel);
+    void accept(IRVisitor *v) const override;
+};
+
+// Runs body on the one partition [i_part_begin, i_part_end) of the coordinate
+// space given by the caller, e.g. as parameters of kernel_shard (see JIT.h).
+// Like a PartitionedForStmt, it locates the partition's position range in
+// each compressed operand and bounds body's loops by those ranges:
+// const uint64_t b_i_iter_part_begin = locate(b, i_part_begin);
+// const uint64_t b_i_iter_part_end = locate(b, i_part_end);
+// ...
+// body;
+struct ShardStmt : public StmtNode {
+    static constexpr StmtKind node_kind = StmtKind::ShardStmt;
+    // Dense level whose coordinate space is sharded.
+    const ArrayLevel extent;
+    // Compressed operands to locate shard bounds in.
+    const IteratorSet compressed;
+    const Stmt body;
+
+    ShardStmt(const ArrayLevel &_extent, const IteratorSet &_compressed, const Stmt &_body)
+        : extent(_extent), compressed(_compressed), body(_body) {
+        assert(extent.format == Format::Dense);
+        for (const auto &iter : compressed.iterators) {
+            assert(iter.format == Format::Compressed);
+        }
+        assert(body.defined());
+    }
+    ~ShardStmt() override = default;
+
+    static const std::shared_ptr<const ShardStmt> make(const ArrayLevel &_extent, const IteratorSet &_compressed, const Stmt &_body);
     void accept(IRVisitor *v) const override;
 };
 
@@ -203,6 +801,7 @@ struct IfStmt : public StmtNode {
 // Compressed:
 //  B_i_iter += (i == B_i);
 struct IncrementIterator : public StmtNode {
+    static constexpr StmtKind node_kind = StmtKind::IncrementIterator;
     const ArrayLevel array;
     // if always is set, then even on Compressed, this will just be a ++
     // useful for optimizing the single-iterator case.
@@ -219,9 +818,25 @@ struct IncrementIterator : public StmtNode {
     void accept(IRVisitor *v) const override;
 };
 
+// Counts an event in a training kernel (see lower_instrumented in Lower.h).
+// Represents, atomically:
+//  branch_counters[index]++;
+struct IncrementCounter : public StmtNode {
+    static constexpr StmtKind node_kind = StmtKind::IncrementCounter;
+    const uint64_t index;
+
+    IncrementCounter(const uint64_t _index)
+        : index(_index) {}
+    ~IncrementCounter() override = default;
+
+    static const std::shared_ptr<const IncrementCounter> make(const uint64_t _index);
+    void accept(IRVisitor *v) const override;
+};
+
 // Represents:
 //  uint64_t a_i = a.crd[a_i_iter]
 struct CompressedIndexDefinition : public StmtNode {
+    static constexpr StmtKind node_kind = StmtKind::CompressedIndexDefinition;
     const ArrayLevel array;
 
     CompressedIndexDefinition(const ArrayLevel &_array)
@@ -237,6 +852,7 @@ struct CompressedIndexDefinition : public StmtNode {
 // Represents:
 //  uint64_t i = min(a_i, min(b_i, ...)
 struct LogicalIndexDefinition : public StmtNode {
+    static constexpr StmtKind node_kind = StmtKind::LogicalIndexDefinition;
     const IteratorSet iterators;
 
     LogicalIndexDefinition(const IteratorSet &_iterators)
@@ -253,6 +869,7 @@ struct LogicalIndexDefinition : public StmtNode {
 // for Compressed iterator b:
 //   uint64_t b_i_iter = b.pos[0];
 struct IteratorDefinition : public StmtNode {
+    static constexpr StmtKind node_kind = StmtKind::IteratorDefinition;
     const IteratorSet iterators;
 
     IteratorDefinition(const IteratorSet &_iterators)
@@ -266,19 +883,29 @@ struct IteratorDefinition : public StmtNode {
 
 // Represents:
 // array[index] = value
+// or, if accumulate is set:
+// array[index] += value
 struct ArrayAssignment : public StmtNode {
+    static constexpr StmtKind node_kind = StmtKind::ArrayAssignment;
     // Which array level this refers to.
     const ArrayLevel array;
     // Value to assign.
     const Expr value;
+    // Whether value is added into the array rather than overwriting it.
+    const bool accumulate;
 
     ArrayAssignment(const ArrayLevel &_array, const Expr &_value)
-        : array(_array), value(_value) {
+        : array(_array), value(_value), accumulate(false) {
+        assert(value.defined());
+    }
+    ArrayAssignment(const ArrayLevel &_array, const Expr &_value, const bool _accumulate)
+        : array(_array), value(_value), accumulate(_accumulate) {
         assert(value.defined());
     }
     ~ArrayAssignment() override = default;
 
     static const std::shared_ptr<const ArrayAssignment> make(const ArrayLevel &_array, const Expr &_value);
+    static const std::shared_ptr<const ArrayAssignment> make(const ArrayLevel &_array, const Expr &_value, const bool _accumulate);
     void accept(IRVisitor *v) const override;
 };
 
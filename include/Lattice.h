@@ -1,5 +1,6 @@
 #pragma once
 
+#include <memory>
 #include <vector>
 
 #include "IndexStmt.h"
@@ -7,25 +8,42 @@
 #include "SetExpr.h"
 #include "IRVisitor.h"
 #include "SetExprUtils.h"
-#include <map>
+#include <unordered_map>
 // One possible interface for implementing MergeLattices
 
 
+// Which operands of a lattice (see MergeLattice::operands) a point still
+// covers, one bit per operand.
+using OperandMask = std::vector<bool>;
+
 struct MergePoint {
     SetExpr sexpr;
     std::vector<LIR::ArrayLevel> iterators;
     std::vector<LIR::ArrayLevel> locators;
     std::vector<MergePoint *> children;
     IndexStmt body;
+    // The operands of sexpr, which identify the point within its lattice.
+    OperandMask operands;
+    // Position in MergeLattice::points.
+    size_t index;
+    // See MergeLattice::get_sub_points.
+    std::vector<const MergePoint *> sub_points;
 };
 
 struct MergeLattice {
-    std::map<SetExpr, MergePoint*, SetComparator> node_map;
+    // Distinct array levels of the lattice's set expression; bit k of a
+    // point's mask stands for operands[k].
+    std::vector<LIR::ArrayLevel> operands;
+    // Every point, in the order they were built (the root first).
+    std::vector<std::unique_ptr<MergePoint>> points;
+    // Points by their set expression. Points with the same operands have the
+    // same set expression, so e.g. B ∪ C and C ∪ B share one.
+    std::unordered_map<SetExpr, MergePoint*, SetExprHash> node_map;
     MergePoint* root;
 
     static MergeLattice make(const SetExpr &sexpr, const IndexStmt &body, const FormatMap &formats);
 
     // Get all of the points from this MergeLattice that are sub-lattices of point,
     // all points that are dominated by point.
-    std::vector<const MergePoint*> get_sub_points(const MergePoint &point) const;
+    const std::vector<const MergePoint*> &get_sub_points(const MergePoint &point) const;
 };
@@ -1,13 +1,97 @@
 #pragma once
 
+#include <string>
+#include <vector>
+
 #include "Array.h"
+#include "CostModel.h"
 #include "Expr.h"
 #include "Format.h"
 #include "IndexStmt.h"
 #include "LIR.h"
+#include "Profile.h"
 
 // Lower from a basic tensor assignment into CIN.
 IndexStmt lower(const Assignment &assignment);
 
-// Lower from CIN into Lowered Stmt
+// Lower assignments to different outputs into one ForAll over the union of
+// their set expressions, with a Multi body (horizontal fusion). Operands
+// shared by the assignments are co-iterated, and read, only once. Outputs
+// must not be read by any of the assignments.
+IndexStmt lower(const std::vector<Assignment> &assignments);
+
+// Lower from CIN into Lowered Stmt, honoring the ForAll's Schedule
+// (see IndexStmt::split and friends).
 LIR::Stmt lower(const IndexStmt &stmt, const FormatMap &formats);
+
+// Ways to lower the loop of a ForAll.
+enum class LoweringStrategy {
+    // Co-iterate the merge lattice: one loop per lattice point.
+    Merge,
+    // Merge every operand with a heap (see LIR::KWayMergeStmt). Requires
+    // every operand to be compressed.
+    KWayMerge,
+    // Scatter each term of a sum of products into the output in its own
+    // pass. Requires a dense output.
+    Scatter,
+};
+
+// The strategies stmt can be lowered with. Without operand statistics,
+// lower(stmt, formats) picks one with fixed rules.
+std::vector<LoweringStrategy> lowering_strategies(const IndexStmt &stmt, const FormatMap &formats);
+
+// Lower with strategy, one of lowering_strategies(stmt, formats).
+LIR::Stmt lower(const IndexStmt &stmt, const FormatMap &formats, const LoweringStrategy strategy);
+
+// The strategy whose kernel estimate_cost (see CostModel.h) expects to be
+// cheapest on operands with stats.
+LoweringStrategy choose_strategy(const IndexStmt &stmt, const FormatMap &formats, const OperandStatsMap &stats);
+
+// Lower with the strategy chosen for operands with stats.
+LIR::Stmt lower(const IndexStmt &stmt, const FormatMap &formats, const OperandStatsMap &stats);
+
+// Ways a variant of a versioned kernel iterates its operands.
+enum class KernelVariantKind {
+    // As lower(stmt, formats) does.
+    Merge,
+    // Visit every coordinate, locating each operand at it (see
+    // LIR::DenseLocateStmt).
+    DenseLocate,
+    // Walk one operand and gallop the others to its coordinates (see
+    // LIR::GallopStmt).
+    Gallop,
+};
+
+// One of several kernels computing the same statement, for compiling them
+// all and choosing between them at run time (see compile_versioned in JIT.h).
+struct KernelVariant {
+    KernelVariantKind kind;
+    // The operand a Gallop variant walks, empty otherwise.
+    std::string lead;
+    LIR::Stmt stmt;
+};
+
+// Variants of the kernel of stmt, honoring its Schedule. The first is always
+// the Merge variant. When every operand is compressed and the output is
+// dense, a DenseLocate variant follows and, if the expression is a product
+// of at least two operands, one Gallop variant led by each operand, in order.
+std::vector<KernelVariant> lower_variants(const IndexStmt &stmt, const FormatMap &formats);
+
+// Lower like lower(stmt, formats), for a training kernel that counts the
+// steps of each lattice loop and of each of its cases (see Profile.h) in
+// branch_counters (see LIR::IncrementCounter). The key of counter n is
+// counter_keys[n]; new keys are appended.
+LIR::Stmt lower_instrumented(const IndexStmt &stmt, const FormatMap &formats, std::vector<std::string> &counter_keys);
+
+// Lower like lower(stmt, formats), dispatching the cases of every loop with
+// steps in profile by an if/else chain ordered by frequency, with
+// __builtin_expect hints, and with rare cases moved out of line.
+LIR::Stmt lower(const IndexStmt &stmt, const FormatMap &formats, const BranchProfile &profile);
+
+// Lower from CIN into a Lowered Stmt that runs on the runtime thread pool.
+// With Partitioning::Coordinates, each thread gets one equal coordinate range.
+// With Partitioning::Nonzeros, tasks are chunks of about grain nonzeros of the
+// largest compressed operand, balanced by work stealing. Requires a dense output.
+LIR::Stmt lower_parallel(const IndexStmt &stmt, const FormatMap &formats,
+                         const LIR::Partitioning partitioning = LIR::Partitioning::Coordinates,
+                         const uint64_t grain = 4096);
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "LIR.h"
+
+// Profiles of how often the cases of lattice loops are taken, counted by a
+// training kernel (see compile_instrumented in JIT.h) and used to order the
+// cases when recompiling (see lower(IndexStmt, FormatMap, BranchProfile) in
+// Lower.h). Loops and cases are keyed by the names of their iterators, so a
+// profile outlives the kernel it was counted by.
+
+struct BranchProfile {
+    // Counts by key: the steps of each loop, by loop_profile_key, and the
+    // steps taking each of its cases, by case_profile_key.
+    std::map<std::string, uint64_t> counts;
+
+    // The count of key, zero if it was never counted.
+    uint64_t count(const std::string &key) const;
+};
+
+// Key of the loop co-iterating iterators, e.g. "B,C".
+std::string loop_profile_key(const std::vector<LIR::ArrayLevel> &iterators);
+
+// Key of the case of the loop over loop_iterators taken where exactly
+// case_iterators match, e.g. "B,C/B".
+std::string case_profile_key(const std::vector<LIR::ArrayLevel> &loop_iterators,
+                             const std::vector<LIR::ArrayLevel> &case_iterators);
+
+// Read the counts training kernels appended to filename, one "<key>\t<count>"
+// line each (see runtime/profile.h), summing the counts of repeated keys.
+BranchProfile read_branch_profile(const std::string &filename);
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+
+#include "Array.h"
+#include "Format.h"
+
+// Cost of lowering an assignment by co-iterating its merge lattice: one loop
+// or branch per lattice point, each evaluating that point's body.
+struct LatticeCost {
+    size_t points = 0;
+    // Additions and multiplications, summed over the bodies of the points.
+    size_t operations = 0;
+
+    bool operator<(const LatticeCost &other) const;
+};
+
+LatticeCost lattice_cost(const Assignment &assignment, const FormatMap &formats);
+
+// Rewrite the right-hand side of assignment into an equivalent expression
+// with a cheaper lattice_cost, if there is one, before lower(Assignment):
+// common factors of sums are factored out (B*C + B*D becomes B*(C + D)), and
+// chains of additions or multiplications are reassociated with compressed
+// operands first. Subexpressions are rewritten bottom-up, and a rewrite is
+// only kept if it lowers the cost, so the result is never worse.
+//
+// The rewritten expression computes the same values up to floating-point
+// rounding, so this is opt-in.
+Assignment rewrite(const Assignment &assignment, const FormatMap &formats);
@@ -21,6 +21,10 @@ enum class SetExprKind {
 
 struct SetExprNode {
     SetExprKind kind;
+    // Set by make(), which interns nodes (see Intern.h): structurally equal
+    // set expressions are the same node, with the same id and hash.
+    uint64_t id = 0;
+    size_t hash = 0;
     virtual void accept(IRVisitor *v) const = 0;
     SetExprNode() {}
     virtual ~SetExprNode() = default;
@@ -47,10 +51,31 @@ struct SetExpr {
         return ptr != nullptr;
     }
 
+    // The node as a T, or nullptr if it is of another kind.
+    template<typename T>
+    std::shared_ptr<const T> as() const {
+        if (!defined() || ptr->kind != T::node_kind) {
+            return nullptr;
+        }
+        return std::static_pointer_cast<const T>(ptr);
+    }
+
+    // Structural equality, since nodes are interned.
+    bool operator==(const SetExpr &other) const {
+        return ptr == other.ptr;
+    }
+
     // Forward a visitor to the underlying pointer.
     void accept(IRVisitor *) const;
 };
 
+// Hash for unordered containers of SetExprs.
+struct SetExprHash {
+    size_t operator()(const SetExpr &sexpr) const {
+        return sexpr.defined() ? sexpr.ptr->hash : 0;
+    }
+};
+
 // Supported operations on SetExprs.
 // Union
 SetExpr operator|(SetExpr a, SetExpr b);
@@ -59,6 +84,7 @@ SetExpr operator&(SetExpr a, SetExpr b);
 
 // Counterpart to the ArrayRead Expr
 struct ArrayDim : public SetExprNode {
+    static constexpr SetExprKind node_kind = SetExprKind::ArrayDim;
     const Access access;
 
     ArrayDim(const Access &_access)
@@ -71,6 +97,7 @@ struct ArrayDim : public SetExprNode {
 
 // Set union. Used for implementing array addition.
 struct Union : public SetExprNode {
+    static constexpr SetExprKind node_kind = SetExprKind::Union;
     SetExpr a, b;
 
     Union(SetExpr _a, SetExpr _b) : a(_a), b(_b) {}
@@ -82,6 +109,7 @@ struct Union : public SetExprNode {
 
 // Set intersection. Used for implementing array multiplication.
 struct Intersection : public SetExprNode {
+    static constexpr SetExprKind node_kind = SetExprKind::Intersection;
     SetExpr a, b;
 
     Intersection(SetExpr _a, SetExpr _b) : a(_a), b(_b) {}
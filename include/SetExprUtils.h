@@ -6,10 +6,18 @@
 
 // Comparator for comparing to set expressions, used for storing set expressions in a map or set
 // This helps to deduplicate merge points for same set expression.
+// Set expressions are interned, so this orders them by id: the order is
+// stable within a process, and structurally equal ones compare equal.
 struct SetComparator{
     bool operator()(const SetExpr &lhs, const SetExpr &rhs) const;
 };
 
+// Canonical form of sexpr: nested unions and intersections are flattened,
+// repeated operands dropped, and operands sorted by SetComparator, then
+// rebuilt left-deep. Set expressions that are equal up to commutativity,
+// associativity and idempotence have the same canonical form.
+SetExpr canonicalize(const SetExpr &sexpr);
+
 SetExpr get_simplified_set_expr(const SetExpr &sexpr, const LIR::ArrayLevel &remove_iterator);
 std::pair<std::vector<LIR::ArrayLevel>, std::vector<LIR::ArrayLevel>> split_iterators_locators(SetExpr sexpr, const FormatMap &formats);
 
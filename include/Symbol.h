@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <ostream>
+#include <string>
+
+// An interned string, e.g. the name of an array. Equal symbols share one
+// copy of their string, so copying, comparing and hashing a symbol is a
+// pointer operation. Symbols convert to const std::string & where a string is
+// expected.
+class Symbol {
+public:
+    // The empty symbol.
+    Symbol();
+    Symbol(const std::string &_name);
+    Symbol(const char *_name);
+
+    const std::string &str() const {
+        return *name;
+    }
+    operator const std::string &() const {
+        return *name;
+    }
+    bool empty() const {
+        return name->empty();
+    }
+
+    bool operator==(const Symbol &other) const {
+        return name == other.name;
+    }
+    bool operator!=(const Symbol &other) const {
+        return name != other.name;
+    }
+    // Alphabetical, so that ordered containers of symbols are deterministic.
+    bool operator<(const Symbol &other) const {
+        return name != other.name && *name < *other.name;
+    }
+
+private:
+    friend struct std::hash<Symbol>;
+
+    const std::string *name;
+};
+
+inline bool operator==(const Symbol &a, const std::string &b) {
+    return a.str() == b;
+}
+inline bool operator==(const std::string &a, const Symbol &b) {
+    return a == b.str();
+}
+inline bool operator==(const Symbol &a, const char *b) {
+    return a.str() == b;
+}
+inline bool operator!=(const Symbol &a, const std::string &b) {
+    return a.str() != b;
+}
+inline bool operator!=(const std::string &a, const Symbol &b) {
+    return a != b.str();
+}
+inline bool operator!=(const Symbol &a, const char *b) {
+    return a.str() != b;
+}
+
+inline std::string operator+(const Symbol &a, const std::string &b) {
+    return a.str() + b;
+}
+inline std::string operator+(const std::string &a, const Symbol &b) {
+    return a + b.str();
+}
+inline std::string operator+(const Symbol &a, const char *b) {
+    return a.str() + b;
+}
+inline std::string operator+(const char *a, const Symbol &b) {
+    return a + b.str();
+}
+
+inline std::ostream &operator<<(std::ostream &stream, const Symbol &symbol) {
+    return stream << symbol.str();
+}
+
+template<>
+struct std::hash<Symbol> {
+    size_t operator()(const Symbol &symbol) const {
+        return std::hash<const std::string *>()(symbol.name);
+    }
+};
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Array.h"
+#include "Format.h"
+
+// A set of assignments compiled into one kernel, in which independent
+// assignments run concurrently (see compile_graph in JIT.h).
+struct TaskGraph {
+    // In program order.
+    std::vector<Assignment> assignments;
+    // Arrays each assignment reads, and the one it writes.
+    std::vector<std::vector<std::string>> reads;
+    std::vector<std::string> writes;
+    // Earlier assignments each one must wait for: those it reads the output
+    // of, those that read its output, and those that write its output.
+    std::vector<std::vector<size_t>> dependencies;
+};
+
+// Infer the dependencies of assignments from the names they read and write.
+TaskGraph make_task_graph(const std::vector<Assignment> &assignments, const FormatMap &formats);
@@ -3,9 +3,15 @@
 // includes all header files in the project.
 
 #include "Access.h"
+#include "Arena.h"
+#include "Autotune.h"
 #include "Array.h"
+#include "Canonicalize.h"
+#include "CostModel.h"
+#include "CSE.h"
 #include "Expr.h"
 #include "Format.h"
+#include "Fusion.h"
 #include "GatherIteratorSet.h"
 #include "IndexStmt.h"
 #include "IRPrinter.h"
@@ -14,4 +20,8 @@
 #include "Lattice.h"
 #include "LIR.h"
 #include "Lower.h"
+#include "Profile.h"
+#include "Rewrite.h"
 #include "SetExpr.h"
+#include "Symbol.h"
+#include "TaskGraph.h"
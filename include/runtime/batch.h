@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+
+#include "runtime/array.h"
+#include "runtime/parallel.h"
+
+// Runtime support for batched kernels, which evaluate one expression over K
+// stacked vectors in a single call (see kernel_batch in JIT.h).
+//
+// A batch of K vectors of extent N is one array with shape[0] == N:
+// - a compressed batch shares one pos array of K + 1 entries; vector k owns
+//   positions [pos[k], pos[k + 1]) of crd and values, with coordinates in
+//   [0, N).
+// - a dense batch stores vector k in values[k * N, (k + 1) * N).
+
+// Vector k of a compressed batch, as an array the kernel can read.
+inline array batch_segment_compressed(const array &a, const uint64_t k) {
+    return array{a.shape, a.pos + k, a.crd, a.values};
+}
+
+// Vector k of a dense batch, as an array the kernel can read.
+inline array batch_segment_dense(const array &a, const uint64_t k) {
+    return array{a.shape, a.pos, a.crd, a.values + k * a.shape[0]};
+}
+
+// Consecutive segments per task, so small vectors don't pay a task each.
+constexpr uint64_t batch_block_segments = 64;
+
+// Calls f(k) for every segment k in [0, K), in parallel across blocks of
+// segments on the kernel thread pool. f must not use the pool itself.
+template<typename F>
+inline void run_batch(const uint64_t K, const F &f) {
+    if (K <= batch_block_segments) {
+        // Not worth waking the pool.
+        for (uint64_t k = 0; k < K; k++) {
+            f(k);
+        }
+        return;
+    }
+    const uint64_t blocks = block_count(K, batch_block_segments);
+    kernel_thread_pool().parallel_for(blocks, [&](const uint64_t block) {
+        const uint64_t end = block_bound(K, block + 1, batch_block_segments);
+        for (uint64_t k = block_bound(K, block, batch_block_segments); k < end; k++) {
+            f(k);
+        }
+    });
+}
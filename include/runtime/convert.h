@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+
+#include "runtime/array.h"
+
+// Conversions between level formats, for calling a kernel on operands stored
+// in other formats than it reads (see autotune_formats in Autotune.h).
+// Conversions write into preallocated arrays of the same extent.
+
+// A zeroed dense array of extent N.
+inline array make_dense_array(const uint64_t N) {
+    array a;
+    a.shape = new uint64_t[1]{N};
+    a.pos = nullptr;
+    a.crd = nullptr;
+    a.values = new float[N]();
+    return a;
+}
+
+// An empty compressed array of extent N, with room for N nonzeros.
+inline array make_compressed_array(const uint64_t N) {
+    array a;
+    a.shape = new uint64_t[1]{N};
+    a.pos = new uint64_t[2]();
+    a.crd = new uint64_t[N];
+    a.values = new float[N];
+    return a;
+}
+
+// Store the nonzeros of dense into compressed.
+inline void convert_to_compressed(const array &dense, array &compressed) {
+    const uint64_t N = dense.shape[0];
+    uint64_t count = 0;
+    for (uint64_t i = 0; i < N; i++) {
+        if (dense.values[i] != 0) {
+            compressed.crd[count] = i;
+            compressed.values[count] = dense.values[i];
+            count++;
+        }
+    }
+    compressed.pos[0] = 0;
+    compressed.pos[1] = count;
+}
+
+// Store compressed into dense, zero where compressed has no nonzero.
+inline void convert_to_dense(const array &compressed, array &dense) {
+    const uint64_t N = dense.shape[0];
+    for (uint64_t i = 0; i < N; i++) {
+        dense.values[i] = 0;
+    }
+    for (uint64_t p = compressed.pos[0]; p < compressed.pos[1]; p++) {
+        dense.values[compressed.crd[p]] = compressed.values[p];
+    }
+}
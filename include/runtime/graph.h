@@ -0,0 +1,60 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "runtime/parallel.h"
+
+// Runtime support for task graphs of kernels (see kernel_graph in JIT.h).
+
+// Runs every task once all of the tasks it depends on have finished, with
+// independent tasks running concurrently on the kernel thread pool.
+// dependencies[t] lists the tasks task t waits for, which must come before t.
+// Tasks must not use the pool themselves.
+inline void run_task_graph(const std::vector<std::function<void()>> &tasks,
+                           const std::vector<std::vector<uint64_t>> &dependencies) {
+    const uint64_t n = tasks.size();
+    std::vector<uint64_t> waiting(n);
+    std::vector<std::vector<uint64_t>> successors(n);
+    std::deque<uint64_t> ready;
+    for (uint64_t t = 0; t < n; t++) {
+        waiting[t] = dependencies[t].size();
+        for (const uint64_t dependency : dependencies[t]) {
+            successors[dependency].push_back(t);
+        }
+        if (waiting[t] == 0) {
+            ready.push_back(t);
+        }
+    }
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    uint64_t finished = 0;
+    kernel_thread_pool().parallel_for_each_thread([&](const uint64_t) {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            wake.wait(lock, [&] { return !ready.empty() || finished == n; });
+            if (ready.empty()) {
+                return;
+            }
+            const uint64_t task = ready.front();
+            ready.pop_front();
+            lock.unlock();
+
+            tasks[task]();
+
+            lock.lock();
+            finished++;
+            for (const uint64_t successor : successors[task]) {
+                if (--waiting[successor] == 0) {
+                    ready.push_back(successor);
+                }
+            }
+            wake.notify_all();
+        }
+    });
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstdint>
+
+// A binary min-heap over (coordinate, operand) pairs, used by kernels that
+// co-iterate many compressed operands with a k-way merge. Ties on coordinate
+// are broken by operand, so operands at the same coordinate pop in order.
+
+template<uint64_t K>
+struct kway_heap {
+    uint64_t crd[K];
+    uint64_t op[K];
+    uint64_t size = 0;
+
+    bool empty() const {
+        return size == 0;
+    }
+
+    uint64_t top_crd() const {
+        return crd[0];
+    }
+
+    uint64_t top_operand() const {
+        return op[0];
+    }
+
+    void push(const uint64_t c, const uint64_t o) {
+        uint64_t n = size++;
+        while (n > 0) {
+            const uint64_t parent = (n - 1) / 2;
+            if (!less(c, o, crd[parent], op[parent])) {
+                break;
+            }
+            crd[n] = crd[parent];
+            op[n] = op[parent];
+            n = parent;
+        }
+        crd[n] = c;
+        op[n] = o;
+    }
+
+    // Remove the smallest entry.
+    void pop() {
+        size--;
+        if (size > 0) {
+            sift_down(crd[size], op[size]);
+        }
+    }
+
+    // Replace the smallest entry's coordinate, keeping its operand. Cheaper
+    // than pop() followed by push() when an operand advances.
+    void replace_top(const uint64_t c) {
+        sift_down(c, op[0]);
+    }
+
+private:
+    static bool less(const uint64_t c0, const uint64_t o0, const uint64_t c1, const uint64_t o1) {
+        return (c0 < c1) || (c0 == c1 && o0 < o1);
+    }
+
+    void sift_down(const uint64_t c, const uint64_t o) {
+        uint64_t n = 0;
+        while (true) {
+            uint64_t child = 2 * n + 1;
+            if (child >= size) {
+                break;
+            }
+            if (child + 1 < size && less(crd[child + 1], op[child + 1], crd[child], op[child])) {
+                child++;
+            }
+            if (!less(crd[child], op[child], c, o)) {
+                break;
+            }
+            crd[n] = crd[child];
+            op[n] = op[child];
+            n = child;
+        }
+        crd[n] = c;
+        op[n] = o;
+    }
+};
+
+// Position of the first coordinate at least c in the sorted crd[begin, end),
+// or end if there is none. Probes at doubling distances from begin, and then
+// binary searches the last gap, so the cost is logarithmic in the
+// distance moved rather than in end - begin. Used by kernels that intersect
+// operands by galloping (see LIR::GallopStmt).
+inline uint64_t gallop(const uint64_t *crd, uint64_t begin, const uint64_t end, const uint64_t c) {
+    uint64_t step = 1;
+    while (begin < end && crd[begin] < c) {
+        const uint64_t probe = begin + step;
+        if (probe >= end || crd[probe] >= c) {
+            // The first coordinate at least c is in (begin, min(probe, end)].
+            uint64_t lo = begin + 1;
+            uint64_t hi = probe < end ? probe : end;
+            while (lo < hi) {
+                const uint64_t mid = lo + (hi - lo) / 2;
+                if (crd[mid] < c) {
+                    lo = mid + 1;
+                } else {
+                    hi = mid;
+                }
+            }
+            return lo;
+        }
+        begin = probe + 1;
+        step *= 2;
+    }
+    return begin;
+}
@@ -0,0 +1,262 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <pthread.h>
+#include <sched.h>
+#include <sstream>
+#include <string>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "runtime/array.h"
+#include "runtime/parallel.h"
+#include "runtime/scheduler.h"
+
+// Runtime support for NUMA machines: pin the kernel thread pool to memory
+// nodes, place the partitions of arrays on the node of the thread that
+// processes them, and estimate how many bytes a kernel reads across nodes.
+//
+// Threads are assigned to nodes in contiguous groups, and partition t of a
+// kernel always runs on thread t (see thread_pool::parallel_for_each_thread),
+// so placement follows the same partitioning as the kernels. Everything
+// degrades to a no-op on machines with a single node.
+
+struct numa_topology {
+    // Kernel ids of the nodes that have CPUs, and the CPUs of each.
+    std::vector<int> node_ids;
+    std::vector<std::vector<int>> node_cpus;
+
+    uint64_t nodes() const {
+        return node_ids.size();
+    }
+};
+
+// Parse a sysfs list such as "0-3,8,10-11".
+inline std::vector<int> parse_numa_list(const std::string &list) {
+    std::vector<int> ids;
+    std::stringstream ranges(list);
+    std::string range;
+    while (std::getline(ranges, range, ',')) {
+        if (range.empty() || range == "\n") {
+            continue;
+        }
+        const size_t dash = range.find('-');
+        const int first = std::stoi(range.substr(0, dash));
+        const int last = (dash == std::string::npos) ? first : std::stoi(range.substr(dash + 1));
+        for (int id = first; id <= last; id++) {
+            ids.push_back(id);
+        }
+    }
+    return ids;
+}
+
+// Read the topology from sysfs. Without it, all CPUs form one node.
+inline numa_topology read_numa_topology() {
+    numa_topology topology;
+    std::ifstream online("/sys/devices/system/node/online");
+    std::string list;
+    if (online && std::getline(online, list)) {
+        for (const int id : parse_numa_list(list)) {
+            std::ifstream cpulist("/sys/devices/system/node/node" + std::to_string(id) + "/cpulist");
+            std::string cpus;
+            if (cpulist && std::getline(cpulist, cpus) && !parse_numa_list(cpus).empty()) {
+                topology.node_ids.push_back(id);
+                topology.node_cpus.push_back(parse_numa_list(cpus));
+            }
+        }
+    }
+    if (topology.nodes() == 0) {
+        const int cpus = std::max(1u, std::thread::hardware_concurrency());
+        topology.node_ids = {0};
+        topology.node_cpus.emplace_back();
+        for (int cpu = 0; cpu < cpus; cpu++) {
+            topology.node_cpus[0].push_back(cpu);
+        }
+    }
+    return topology;
+}
+
+inline const numa_topology &kernel_numa_topology() {
+    static const numa_topology topology = read_numa_topology();
+    return topology;
+}
+
+// Node (an index into the topology) of thread t of a pool of threads.
+inline uint64_t numa_node_of_thread(const uint64_t t, const uint64_t threads) {
+    return t * kernel_numa_topology().nodes() / threads;
+}
+
+// Pin every thread of the kernel thread pool to the CPUs of its node.
+// Returns false if the OS refused, e.g. because those CPUs are not allowed.
+inline bool numa_pin_kernel_threads() {
+    const numa_topology &topology = kernel_numa_topology();
+    if (topology.nodes() <= 1) {
+        return true;
+    }
+    thread_pool &pool = kernel_thread_pool();
+    bool pinned = true;
+    for (uint64_t t = 0; t < pool.size(); t++) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        for (const int cpu : topology.node_cpus[numa_node_of_thread(t, pool.size())]) {
+            CPU_SET(cpu, &cpus);
+        }
+        pinned &= pthread_setaffinity_np(pool.native_handle(t), sizeof(cpus), &cpus) == 0;
+    }
+    return pinned;
+}
+
+// Coordinate range of each thread of a kernel partitioned one range per
+// thread (Partitioning::Coordinates): thread t gets [bounds[t], bounds[t + 1]).
+inline std::vector<uint64_t> numa_coordinate_bounds(const uint64_t extent, const uint64_t threads) {
+    std::vector<uint64_t> bounds;
+    for (uint64_t t = 0; t <= threads; t++) {
+        bounds.push_back(partition_bound(extent, t, threads));
+    }
+    return bounds;
+}
+
+// Coordinate range each thread is dealt by run_balanced, for chunks of grain
+// nonzeros of position_operand (Partitioning::Nonzeros). Stolen chunks run
+// elsewhere, so this is where each chunk is processed when the load is even.
+inline std::vector<uint64_t> numa_balanced_bounds(const array *position_operand, const uint64_t extent,
+                                                  const uint64_t grain, const uint64_t threads) {
+    const uint64_t chunks = balanced_chunk_count(position_operand, extent, grain);
+    const uint64_t dealt = std::max<uint64_t>(1, std::min(threads, chunks));
+    std::vector<uint64_t> bounds;
+    for (uint64_t t = 0; t <= threads; t++) {
+        const uint64_t chunk = partition_bound(chunks, std::min(t, dealt), dealt);
+        bounds.push_back(balanced_chunk_bound(position_operand, extent, chunk, chunks));
+    }
+    return bounds;
+}
+
+// Calls f(t, begin, end) with the bytes of a that thread t reads: its values
+// (and crd, if compressed) within the thread's coordinate range.
+inline void for_each_numa_partition(const array &a, const bool compressed, const std::vector<uint64_t> &bounds,
+                                    const std::function<void(uint64_t, const void *, const void *)> &f) {
+    for (uint64_t t = 0; t + 1 < bounds.size(); t++) {
+        if (compressed) {
+            const uint64_t begin = locate(a, bounds[t]);
+            const uint64_t end = locate(a, bounds[t + 1]);
+            f(t, a.crd + begin, a.crd + end);
+            f(t, a.values + begin, a.values + end);
+        } else {
+            f(t, a.values + bounds[t], a.values + bounds[t + 1]);
+        }
+    }
+}
+
+// Constants of the mbind and move_pages syscalls (see <numaif.h>).
+constexpr int numa_mpol_bind = 2;
+constexpr unsigned numa_mpol_mf_move = 1 << 1;
+
+// Bind (and move) the whole pages of [begin, end) to node. Pages shared with
+// a neighbouring partition stay where they are.
+inline bool numa_bind(const void *begin, const void *end, const uint64_t node) {
+    const uintptr_t page = sysconf(_SC_PAGESIZE);
+    const uintptr_t first = (reinterpret_cast<uintptr_t>(begin) + page - 1) / page * page;
+    const uintptr_t last = reinterpret_cast<uintptr_t>(end) / page * page;
+    const int id = kernel_numa_topology().node_ids[node];
+    if (first >= last) {
+        return true;
+    }
+    if (id >= 64) {
+        return false;
+    }
+    const unsigned long mask = 1ul << id;
+    return syscall(SYS_mbind, first, last - first, numa_mpol_bind, &mask, 8 * sizeof(mask) + 1, numa_mpol_mf_move) == 0;
+}
+
+// Move the partitions of a (values, and crd if compressed) to the nodes of
+// the threads that process them, given each thread's coordinate range (see
+// numa_coordinate_bounds and numa_balanced_bounds). Returns false if any
+// range could not be moved.
+inline bool numa_place(const array &a, const bool compressed, const std::vector<uint64_t> &bounds) {
+    if (kernel_numa_topology().nodes() <= 1) {
+        return true;
+    }
+    bool placed = true;
+    const uint64_t threads = bounds.size() - 1;
+    for_each_numa_partition(a, compressed, bounds, [&](const uint64_t t, const void *begin, const void *end) {
+        placed &= numa_bind(begin, end, numa_node_of_thread(t, threads));
+    });
+    return placed;
+}
+
+// Allocate zeroed values for a dense array of extent coordinates, zeroing
+// each thread's partition from that thread, so first-touch places it on the
+// thread's node (pin the threads first). Free with numa_free_values.
+inline float *numa_alloc_values(const uint64_t extent) {
+    const size_t bytes = std::max<uint64_t>(1, extent) * sizeof(float);
+    void *memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        return nullptr;
+    }
+    float *values = static_cast<float *>(memory);
+    thread_pool &pool = kernel_thread_pool();
+    const std::vector<uint64_t> bounds = numa_coordinate_bounds(extent, pool.size());
+    pool.parallel_for_each_thread([&](const uint64_t t) {
+        std::fill(values + bounds[t], values + bounds[t + 1], 0.0f);
+    });
+    return values;
+}
+
+inline void numa_free_values(float *values, const uint64_t extent) {
+    munmap(values, std::max<uint64_t>(1, extent) * sizeof(float));
+}
+
+struct numa_traffic {
+    // Bytes threads read from their own node, and from other nodes.
+    uint64_t local_bytes = 0;
+    uint64_t remote_bytes = 0;
+
+    numa_traffic &operator+=(const numa_traffic &other) {
+        local_bytes += other.local_bytes;
+        remote_bytes += other.remote_bytes;
+        return *this;
+    }
+};
+
+// Estimate the traffic of reading a (values, and crd if compressed) once,
+// from the current node of every page it spans. Pages not yet placed count
+// as local, since the first thread to touch them will place them.
+inline numa_traffic numa_estimate_traffic(const array &a, const bool compressed, const std::vector<uint64_t> &bounds) {
+    numa_traffic traffic;
+    const numa_topology &topology = kernel_numa_topology();
+    const uint64_t threads = bounds.size() - 1;
+    const uintptr_t page = sysconf(_SC_PAGESIZE);
+    for_each_numa_partition(a, compressed, bounds, [&](const uint64_t t, const void *begin, const void *end) {
+        const uintptr_t lo = reinterpret_cast<uintptr_t>(begin);
+        const uintptr_t hi = reinterpret_cast<uintptr_t>(end);
+        if (topology.nodes() <= 1) {
+            traffic.local_bytes += hi - lo;
+            return;
+        }
+        std::vector<void *> pages;
+        for (uintptr_t p = lo / page * page; p < hi; p += page) {
+            pages.push_back(reinterpret_cast<void *>(p));
+        }
+        std::vector<int> status(pages.size(), -1);
+        if (!pages.empty() && syscall(SYS_move_pages, 0, pages.size(), pages.data(), nullptr, status.data(), 0) != 0) {
+            std::fill(status.begin(), status.end(), -1);
+        }
+        const int node = topology.node_ids[numa_node_of_thread(t, threads)];
+        for (size_t i = 0; i < pages.size(); i++) {
+            const uintptr_t p = reinterpret_cast<uintptr_t>(pages[i]);
+            const uint64_t bytes = std::min(hi, p + page) - std::max(lo, p);
+            if (status[i] < 0 || status[i] == node) {
+                traffic.local_bytes += bytes;
+            } else {
+                traffic.remote_bytes += bytes;
+            }
+        }
+    });
+    return traffic;
+}
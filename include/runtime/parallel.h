@@ -0,0 +1,185 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <mutex>
+#include <pthread.h>
+#include <thread>
+#include <vector>
+
+#include "runtime/array.h"
+
+// Runtime support for parallel kernels: a small thread pool, and helpers for
+// splitting the coordinate space into partitions.
+
+struct thread_pool {
+    // Runs with num_threads threads in total, counting the caller of parallel_for.
+    explicit thread_pool(const uint64_t num_threads) {
+        for (uint64_t t = 1; t < num_threads; t++) {
+            workers.emplace_back([this, t] { work(t); });
+        }
+    }
+
+    ~thread_pool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto &worker : workers) {
+            worker.join();
+        }
+    }
+
+    uint64_t size() const {
+        return workers.size() + 1;
+    }
+
+    // Handle of thread t (0 is the caller of parallel_for), e.g. to pin it.
+    pthread_t native_handle(const uint64_t t) {
+        return t == 0 ? pthread_self() : workers[t - 1].native_handle();
+    }
+
+    // Calls f(task) for every task in [0, n), and returns once all have finished.
+    // Calls from different threads are serialized; f must not call back into the pool.
+    void parallel_for(const uint64_t n, const std::function<void(uint64_t)> &f) {
+        launch(n, f, false);
+    }
+
+    // Calls f(t) on thread t for every thread of the pool, so the same thread
+    // always gets the same task (and its data stays in that thread's caches
+    // and memory node).
+    void parallel_for_each_thread(const std::function<void(uint64_t)> &f) {
+        launch(size(), f, true);
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::mutex calls;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    const std::function<void(uint64_t)> *job = nullptr;
+    uint64_t job_size = 0;
+    bool job_per_thread = false;
+    uint64_t generation = 0;
+    uint64_t busy = 0;
+    bool stopping = false;
+    std::atomic<uint64_t> next_task{0};
+
+    void launch(const uint64_t n, const std::function<void(uint64_t)> &f, const bool per_thread) {
+        std::lock_guard<std::mutex> call(calls);
+        std::unique_lock<std::mutex> lock(mutex);
+        job = &f;
+        job_size = n;
+        job_per_thread = per_thread;
+        next_task.store(0);
+        busy = workers.size();
+        generation++;
+        lock.unlock();
+        wake.notify_all();
+
+        if (per_thread) {
+            f(0);
+        } else {
+            run_tasks(f, n);
+        }
+
+        lock.lock();
+        done.wait(lock, [this] { return busy == 0; });
+        job = nullptr;
+    }
+
+    void run_tasks(const std::function<void(uint64_t)> &f, const uint64_t n) {
+        for (uint64_t task = next_task.fetch_add(1); task < n; task = next_task.fetch_add(1)) {
+            f(task);
+        }
+    }
+
+    void work(const uint64_t index) {
+        uint64_t seen = 0;
+        while (true) {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) {
+                return;
+            }
+            seen = generation;
+            const auto *f = job;
+            const uint64_t n = job_size;
+            const bool per_thread = job_per_thread;
+            lock.unlock();
+
+            if (per_thread) {
+                (*f)(index);
+            } else {
+                run_tasks(*f, n);
+            }
+
+            lock.lock();
+            if (--busy == 0) {
+                done.notify_one();
+            }
+        }
+    }
+};
+
+// Number of threads parallel kernels use: $KERNEL_NUM_THREADS if set,
+// otherwise the hardware concurrency.
+inline uint64_t kernel_num_threads() {
+    if (const char *env = std::getenv("KERNEL_NUM_THREADS")) {
+        const long n = std::atol(env);
+        if (n > 0) {
+            return n;
+        }
+    }
+    const unsigned n = std::thread::hardware_concurrency();
+    return (n > 0) ? n : 1;
+}
+
+// The pool shared by every kernel in the process, created on first use.
+inline thread_pool &kernel_thread_pool() {
+    static thread_pool pool(kernel_num_threads());
+    return pool;
+}
+
+// Start of partition part (of parts) of the coordinate space [0, extent).
+inline uint64_t partition_bound(const uint64_t extent, const uint64_t part, const uint64_t parts) {
+    return (extent / parts) * part + std::min(extent % parts, part);
+}
+
+// Number of blocks of size coordinates covering [0, extent).
+inline uint64_t block_count(const uint64_t extent, const uint64_t size) {
+    return std::max<uint64_t>(1, (extent + size - 1) / size);
+}
+
+// Start of block (of size coordinates) of the coordinate space [0, extent).
+inline uint64_t block_bound(const uint64_t extent, const uint64_t block, const uint64_t size) {
+    return std::min(extent, block * size);
+}
+
+// bound moved into [begin, end). Partitions of the whole coordinate space
+// clamped to a shard's range partition that range, leaving the rest empty.
+inline uint64_t clamp_bound(const uint64_t bound, const uint64_t begin, const uint64_t end) {
+    return std::min(end, std::max(begin, bound));
+}
+
+// Position of the first nonzero of a compressed array at or after coordinate,
+// found by binary search over crd.
+inline uint64_t locate(const array &a, const uint64_t coordinate) {
+    uint64_t lo = a.pos[0];
+    uint64_t hi = a.pos[1];
+    while (lo < hi) {
+        const uint64_t mid = lo + (hi - lo) / 2;
+        if (a.crd[mid] < coordinate) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
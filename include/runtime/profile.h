@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+
+// Runtime support for training kernels (see compile_instrumented in JIT.h),
+// which count how often the cases of their loops are taken in
+// branch_counters.
+
+// Append each of K counts, with its key, to filename as a "<key>\t<count>"
+// line (see read_branch_profile in Profile.h).
+inline void append_branch_profile(const char *filename, const char *const *keys, const uint64_t *counts, const uint64_t K) {
+    FILE *file = fopen(filename, "a");
+    if (file == nullptr) {
+        return;
+    }
+    for (uint64_t k = 0; k < K; k++) {
+        fprintf(file, "%s\t%llu\n", keys[k], static_cast<unsigned long long>(counts[k]));
+    }
+    fclose(file);
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "runtime/array.h"
+#include "runtime/parallel.h"
+
+// Runtime support for load-balanced parallel kernels: tasks are chunks of
+// about the same number of nonzeros, run by a work-stealing scheduler on the
+// kernel thread pool.
+
+struct scheduler_stats {
+    uint64_t tasks = 0;
+    // Tasks run by a thread other than the one they were dealt to.
+    uint64_t steals = 0;
+    // Time threads spent looking for work, summed over threads.
+    uint64_t idle_ns = 0;
+};
+
+// Statistics of the last balanced kernel run launched from this thread.
+inline scheduler_stats &kernel_scheduler_stats() {
+    static thread_local scheduler_stats stats;
+    return stats;
+}
+
+// A deque of task ids. The owning thread pops from the back, thieves from the front.
+struct task_deque {
+    std::mutex mutex;
+    std::deque<uint64_t> tasks;
+
+    bool pop_back(uint64_t &task) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (tasks.empty()) {
+            return false;
+        }
+        task = tasks.back();
+        tasks.pop_back();
+        return true;
+    }
+
+    bool pop_front(uint64_t &task) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (tasks.empty()) {
+            return false;
+        }
+        task = tasks.front();
+        tasks.pop_front();
+        return true;
+    }
+};
+
+// Calls f(task) for every task in [0, n) on the kernel thread pool. Each
+// thread is dealt a contiguous block of tasks, and steals from the others
+// once its own deque runs dry.
+inline void run_balanced(const uint64_t n, const std::function<void(uint64_t)> &f) {
+    using clock = std::chrono::steady_clock;
+    thread_pool &pool = kernel_thread_pool();
+    const uint64_t threads = std::max<uint64_t>(1, std::min(pool.size(), n));
+
+    std::vector<task_deque> deques(threads);
+    for (uint64_t t = 0; t < threads; t++) {
+        for (uint64_t task = partition_bound(n, t, threads); task < partition_bound(n, t + 1, threads); task++) {
+            deques[t].tasks.push_back(task);
+        }
+    }
+
+    std::atomic<uint64_t> remaining{n};
+    std::atomic<uint64_t> steals{0};
+    std::atomic<uint64_t> idle_ns{0};
+    pool.parallel_for(threads, [&](const uint64_t t) {
+        clock::time_point idle_since = clock::now();
+        bool idle = false;
+        while (remaining.load() > 0) {
+            uint64_t task;
+            bool found = deques[t].pop_back(task);
+            for (uint64_t k = 1; !found && k < threads; k++) {
+                found = deques[(t + k) % threads].pop_front(task);
+                steals += found;
+            }
+            if (!found) {
+                if (!idle) {
+                    idle = true;
+                    idle_since = clock::now();
+                }
+                std::this_thread::yield();
+                continue;
+            }
+            if (idle) {
+                idle = false;
+                idle_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - idle_since).count();
+            }
+            f(task);
+            remaining--;
+        }
+        if (idle) {
+            idle_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - idle_since).count();
+        }
+    });
+
+    kernel_scheduler_stats() = scheduler_stats{n, steals.load(), idle_ns.load()};
+}
+
+// Number of chunks of about grain nonzeros in a compressed array, or of grain
+// coordinates in [0, extent) if there is no compressed operand.
+inline uint64_t balanced_chunk_count(const array *largest, const uint64_t extent, const uint64_t grain) {
+    const uint64_t size = largest ? (largest->pos[1] - largest->pos[0]) : extent;
+    return std::max<uint64_t>(1, (size + grain - 1) / grain);
+}
+
+// Start coordinate of chunk (of chunks). Chunks split the positions of the
+// largest compressed operand evenly, so each covers about the same number of
+// its nonzeros, however they are spread over coordinates.
+inline uint64_t balanced_chunk_bound(const array *largest, const uint64_t extent, const uint64_t chunk, const uint64_t chunks) {
+    if (!largest) {
+        return partition_bound(extent, chunk, chunks);
+    }
+    if (chunk == 0) {
+        return 0;
+    }
+    if (chunk == chunks) {
+        return extent;
+    }
+    const uint64_t nnz = largest->pos[1] - largest->pos[0];
+    return largest->crd[largest->pos[0] + partition_bound(nnz, chunk, chunks)];
+}
@@ -0,0 +1,200 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <functional>
+#include <initializer_list>
+#include <iostream>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+#include "runtime/array.h"
+#include "runtime/parallel.h"
+#include "runtime/scheduler.h"
+
+// Runtime support for sharded kernels, which split the coordinate space
+// across worker processes (see kernel_sharded in JIT.h). The driver copies
+// every array into a POSIX shared memory object. Each worker attaches them
+// with shm_open and mmap, runs kernel_shard on its coordinate range, and
+// writes only that range of the dense output. Only local IPC is used, and a
+// worker that crashes loses nothing but its own shard.
+
+// An array in shared memory: this header, then shape, pos, crd and values.
+struct shm_header {
+    uint64_t extent;
+    uint64_t compressed;
+    // Nonzeros of a compressed array, extent of a dense one.
+    uint64_t count;
+};
+
+// View of an array laid out in shared memory at base.
+inline array shm_array_view(void *base) {
+    shm_header *header = static_cast<shm_header *>(base);
+    uint64_t *shape = reinterpret_cast<uint64_t *>(header + 1);
+    uint64_t *pos = shape + 1;
+    uint64_t *crd = pos + 2;
+    float *values = reinterpret_cast<float *>(crd + (header->compressed ? header->count : 0));
+    return array{shape, pos, header->compressed ? crd : nullptr, values};
+}
+
+inline size_t shm_array_bytes(const uint64_t count, const bool compressed) {
+    return sizeof(shm_header) + 3 * sizeof(uint64_t) + (compressed ? count * sizeof(uint64_t) : 0) + count * sizeof(float);
+}
+
+// Number of shard sets created so far in this process, which tells apart
+// the objects of concurrent sharded kernel calls (e.g. in a task graph).
+inline uint64_t next_shard_set() {
+    static std::atomic<uint64_t> sets{0};
+    return sets++;
+}
+
+// The arrays of one sharded kernel call, in shared memory. The objects are
+// unlinked when the set is destroyed.
+struct shard_set {
+    explicit shard_set(const std::string &prefix)
+        : prefix("/" + prefix + "_" + std::to_string(getpid()) + "_" + std::to_string(next_shard_set())) {
+    }
+
+    ~shard_set() {
+        for (const auto &segment : segments) {
+            munmap(segment.base, segment.bytes);
+            shm_unlink(segment.name.c_str());
+        }
+    }
+
+    shard_set(const shard_set &) = delete;
+    shard_set &operator=(const shard_set &) = delete;
+
+    // Copy a into a new shared memory object. Returns false on failure.
+    bool share(const array &a, const bool compressed) {
+        const std::string name = prefix + "_" + std::to_string(segments.size());
+        const uint64_t begin = compressed ? a.pos[0] : 0;
+        const uint64_t count = compressed ? a.pos[1] - a.pos[0] : a.shape[0];
+        const size_t bytes = shm_array_bytes(count, compressed);
+
+        const int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd < 0) {
+            return false;
+        }
+        void *base = (ftruncate(fd, bytes) == 0) ? mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+        close(fd);
+        if (base == MAP_FAILED) {
+            shm_unlink(name.c_str());
+            return false;
+        }
+        segments.push_back(segment{name, base, bytes});
+
+        *static_cast<shm_header *>(base) = shm_header{a.shape[0], compressed, count};
+        array shared = shm_array_view(base);
+        shared.shape[0] = a.shape[0];
+        shared.pos[0] = 0;
+        shared.pos[1] = compressed ? count : 0;
+        if (compressed) {
+            std::memcpy(shared.crd, a.crd + begin, count * sizeof(uint64_t));
+        }
+        std::memcpy(shared.values, a.values + begin, count * sizeof(float));
+        return true;
+    }
+
+    // Map every shared array into this process (e.g. a worker), in the order
+    // they were shared. The mappings last until the process exits.
+    std::vector<array> attach() const {
+        std::vector<array> arrays;
+        for (const auto &segment : segments) {
+            const int fd = shm_open(segment.name.c_str(), O_RDWR, 0);
+            void *base = (fd < 0) ? MAP_FAILED : mmap(nullptr, segment.bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (fd >= 0) {
+                close(fd);
+            }
+            if (base == MAP_FAILED) {
+                return {};
+            }
+            arrays.push_back(shm_array_view(base));
+        }
+        return arrays;
+    }
+
+    // Copy the values of shared dense array index back into a.
+    void copy_back(const size_t index, array &a) const {
+        const array shared = shm_array_view(segments[index].base);
+        std::memcpy(a.values, shared.values, a.shape[0] * sizeof(float));
+    }
+
+    size_t size() const {
+        return segments.size();
+    }
+
+private:
+    struct segment {
+        std::string name;
+        void *base;
+        size_t bytes;
+    };
+
+    const std::string prefix;
+    std::vector<segment> segments;
+};
+
+// The compressed operand with the most nonzeros, or nullptr if there is none.
+inline const array *largest_compressed(const std::initializer_list<const array *> operands) {
+    const array *largest = nullptr;
+    for (const array *a : operands) {
+        if (!largest || a->pos[1] - a->pos[0] > largest->pos[1] - largest->pos[0]) {
+            largest = a;
+        }
+    }
+    return largest;
+}
+
+// Coordinate bounds of shards: shard p covers [bounds[p], bounds[p + 1]).
+// Shards hold about the same number of nonzeros of largest (as with
+// Partitioning::Nonzeros), or of coordinates without a compressed operand.
+inline std::vector<uint64_t> shard_bounds(const array *largest, const uint64_t extent, const uint64_t shards) {
+    std::vector<uint64_t> bounds;
+    for (uint64_t p = 0; p <= shards; p++) {
+        bounds.push_back(balanced_chunk_bound(largest, extent, p, shards));
+    }
+    return bounds;
+}
+
+// Runs shard(begin, end) for every shard in its own worker process, and waits
+// for all of them. Returns the number of shards whose worker could not start,
+// crashed, or exited with an error.
+inline uint64_t run_sharded(const std::vector<uint64_t> &bounds, const std::function<void(uint64_t, uint64_t)> &shard) {
+    // Don't let workers flush the driver's buffered output a second time.
+    std::cout.flush();
+    std::fflush(nullptr);
+
+    uint64_t failed = 0;
+    std::vector<pid_t> workers;
+    for (uint64_t p = 0; p + 1 < bounds.size(); p++) {
+        const pid_t pid = fork();
+        if (pid == 0) {
+            try {
+                shard(bounds[p], bounds[p + 1]);
+            } catch (...) {
+                _exit(1);
+            }
+            _exit(0);
+        }
+        if (pid < 0) {
+            failed++;
+        } else {
+            workers.push_back(pid);
+        }
+    }
+    for (const pid_t pid : workers) {
+        int status = 0;
+        if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            failed++;
+        }
+    }
+    return failed;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+// Runtime support for versioned kernels, which are compiled several ways
+// (see compile_versioned in JIT.h) and pick one per call. The kernel's
+// prologue reads the extent of the coordinate space and the nonzeros of each
+// of its K compressed operands, estimates the cost of every variant from
+// them, and runs the cheapest. Costs are in rough operations per call; only
+// how they compare matters.
+
+// Operations per nonzero and operand of a linear merge step: comparing the
+// coordinate against the minimum, and advancing.
+constexpr double merge_variant_step = 2;
+// Operations per galloped operand and step of the lead, besides probes.
+constexpr double gallop_variant_step = 4;
+// Operations per probe of a gallop: a load and a branch that is hard to
+// predict.
+constexpr double gallop_variant_probe = 4;
+// Operations per coordinate and operand of a dense-locator step: a bounds
+// test, a coordinate test and a conditional advance.
+constexpr double dense_locate_variant_step = 3;
+
+// A linear merge takes a step per nonzero of any operand, and every step
+// tests every operand.
+inline double merge_variant_cost(const uint64_t *nnz, const uint64_t K) {
+    double steps = 0;
+    for (uint64_t k = 0; k < K; k++) {
+        steps += double(nnz[k]);
+    }
+    return merge_variant_step * double(K) * steps;
+}
+
+// Galloping takes a step per nonzero of the lead operand, and moves every
+// other operand k over about nnz[k] / nnz[lead] positions per step, in a
+// number of probes logarithmic in that distance.
+inline double gallop_variant_cost(const uint64_t *nnz, const uint64_t K, const uint64_t lead) {
+    const double steps = double(nnz[lead]);
+    double per_step = 1;
+    for (uint64_t k = 0; k < K; k++) {
+        if (k != lead) {
+            const double distance = double(nnz[k]) / (steps > 1 ? steps : 1);
+            per_step += gallop_variant_step + gallop_variant_probe * std::log2(distance + 1);
+        }
+    }
+    return steps * per_step;
+}
+
+// Locating takes a step per coordinate, and every step tests every operand.
+inline double dense_locate_variant_cost(const uint64_t extent, const uint64_t K) {
+    return double(extent) * (1 + dense_locate_variant_step * double(K));
+}
+
+// Index of the smallest of costs[0, count), the first one on ties.
+inline uint64_t cheapest_variant(const double *costs, const uint64_t count) {
+    uint64_t best = 0;
+    for (uint64_t v = 1; v < count; v++) {
+        if (costs[v] < costs[best]) {
+            best = v;
+        }
+    }
+    return best;
+}
@@ -0,0 +1,48 @@
+#include "Arena.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace {
+
+// Blocks hold at least this many bytes; larger nodes get a block of their own.
+constexpr size_t arena_block_bytes = 64 * 1024;
+
+thread_local IRArena *current_arena = nullptr;
+
+}  // namespace
+
+void *IRArena::Blocks::allocate(const size_t bytes, const size_t alignment) {
+    size_t padding = (alignment - reinterpret_cast<uintptr_t>(next) % alignment) % alignment;
+    if (next == nullptr || padding + bytes > remaining) {
+        const size_t size = std::max(arena_block_bytes, bytes + alignment);
+        blocks.emplace_back(new char[size]);
+        next = blocks.back().get();
+        remaining = size;
+        padding = (alignment - reinterpret_cast<uintptr_t>(next) % alignment) % alignment;
+    }
+    void *memory = next + padding;
+    next += padding + bytes;
+    remaining -= padding + bytes;
+    allocated += bytes;
+    return memory;
+}
+
+IRArena::IRArena()
+    : previous(current_arena) {
+    current_arena = this;
+}
+
+IRArena::~IRArena() {
+    // A node made in this scope outlived it.
+    assert(blocks.live == 0);
+    current_arena = previous;
+}
+
+size_t IRArena::allocated() const {
+    return blocks.allocated;
+}
+
+IRArena *IRArena::current() {
+    return current_arena;
+}
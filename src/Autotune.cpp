@@ -0,0 +1,228 @@
+#include "Autotune.h"
+
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "Canonicalize.h"
+#include "JIT.h"
+#include "Lower.h"
+
+namespace {
+
+// Timed calls of each candidate, after one untimed call.
+constexpr int autotune_repeats = 5;
+
+Format format_of(const FormatMap &formats, const std::string &name) {
+    auto format = formats.find(name);
+    return (format != formats.end() && !format->second.empty()) ? format->second.front() : Format::Dense;
+}
+
+// Write the extent of sample, then the values of each operand in arg_list
+// (after the output), in the raw form the timing harness reads.
+void write_sample(const std::string &filename, const std::vector<std::string> &arg_list, const FormatSample &sample) {
+    std::ofstream file(filename, std::ios::binary);
+    file.write(reinterpret_cast<const char *>(&sample.extent), sizeof(sample.extent));
+    const std::vector<float> zeros(sample.extent, 0.0f);
+    for (size_t a = 1; a < arg_list.size(); a++) {
+        auto values = sample.values.find(arg_list[a]);
+        const std::vector<float> &operand = values != sample.values.end() ? values->second : zeros;
+        assert(operand.size() == sample.extent);
+        file.write(reinterpret_cast<const char *>(operand.data()), sample.extent * sizeof(float));
+    }
+}
+
+// Emit a harness that loads the sample in data_file into arrays stored in
+// sample.formats, then times converting them to formats and calling kernel,
+// and prints the best time as "seconds <t>".
+void write_harness(const std::string &filename, const std::string &data_file, const std::vector<std::string> &arg_list,
+                   const FormatMap &formats, const FormatSample &sample) {
+    std::ofstream file(filename);
+    file << "#include <chrono>\n";
+    file << "#include <cstdio>\n\n";
+    file << "#include \"runtime/convert.h\"\n\n";
+    file << "int main() {\n";
+    file << "  FILE *data = fopen(\"" << data_file << "\", \"rb\");\n";
+    file << "  uint64_t N = 0;\n";
+    file << "  if (data == nullptr || fread(&N, sizeof(N), 1, data) != 1) {\n";
+    file << "    return 1;\n";
+    file << "  }\n";
+    file << "  array " << arg_list[0] << " = make_dense_array(N);\n";
+    for (size_t a = 1; a < arg_list.size(); a++) {
+        const std::string &name = arg_list[a];
+        const Format stored = format_of(sample.formats, name);
+        const Format read = format_of(formats, name);
+        file << "  array " << name << "_sample = make_dense_array(N);\n";
+        file << "  if (fread(" << name << "_sample.values, sizeof(float), N, data) != N) {\n";
+        file << "    return 1;\n";
+        file << "  }\n";
+        if (stored == Format::Compressed) {
+            file << "  array " << name << "_stored = make_compressed_array(N);\n";
+            file << "  convert_to_compressed(" << name << "_sample, " << name << "_stored);\n";
+        } else {
+            file << "  array " << name << "_stored = " << name << "_sample;\n";
+        }
+        if (read == stored) {
+            file << "  array " << name << " = " << name << "_stored;\n";
+        } else {
+            file << "  array " << name << " = make_" << (read == Format::Compressed ? "compressed" : "dense") << "_array(N);\n";
+        }
+    }
+    file << "  fclose(data);\n\n";
+
+    file << "  double best = 1e30;\n";
+    file << "  for (int r = 0; r <= " << autotune_repeats << "; r++) {\n";
+    file << "    const auto start = std::chrono::steady_clock::now();\n";
+    for (size_t a = 1; a < arg_list.size(); a++) {
+        const std::string &name = arg_list[a];
+        const Format read = format_of(formats, name);
+        if (read != format_of(sample.formats, name)) {
+            file << "    convert_to_" << (read == Format::Compressed ? "compressed" : "dense") << "(" << name << "_stored, "
+                 << name << ");\n";
+        }
+    }
+    file << "    kernel(";
+    for (size_t a = 0; a < arg_list.size(); a++) {
+        file << (a != 0 ? ", " : "") << arg_list[a];
+    }
+    file << ");\n";
+    file << "    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;\n";
+    file << "    if (r != 0 && elapsed.count() < best) {\n";
+    file << "      best = elapsed.count();\n";
+    file << "    }\n";
+    file << "  }\n";
+    file << "  printf(\"seconds %.9g\\n\", best);\n";
+    file << "  return 0;\n";
+    file << "}\n";
+}
+
+// Key of sample's winner in the cache file: the kernel of assignment on the
+// formats of sample, and the density of each operand rounded to a power of
+// two.
+std::string autotune_key(const Assignment &assignment, const FormatSample &sample) {
+    std::ostringstream key;
+    key << kernel_cache_key(assignment, sample.formats);
+    for (const auto &name : get_arg_list(lower(assignment), sample.formats)) {
+        auto values = sample.values.find(name);
+        if (values == sample.values.end()) {
+            continue;
+        }
+        uint64_t nnz = 0;
+        for (const float v : values->second) {
+            nnz += (v != 0);
+        }
+        key << " " << name << "@";
+        if (nnz == 0) {
+            key << "empty";
+        } else {
+            key << std::lround(std::log2(double(nnz) / double(sample.extent)));
+        }
+    }
+    return key.str();
+}
+
+// Formats printed as in the cache file, e.g. "A:d B:c".
+std::string print_formats(const FormatMap &formats) {
+    std::ostringstream printed;
+    for (const auto &[name, levels] : formats) {
+        printed << (printed.tellp() != 0 ? " " : "") << name << ":"
+                << (levels.front() == Format::Compressed ? "c" : "d");
+    }
+    return printed.str();
+}
+
+FormatMap parse_formats(const std::string &printed) {
+    FormatMap formats;
+    std::istringstream stream(printed);
+    std::string entry;
+    while (stream >> entry) {
+        const size_t colon = entry.rfind(':');
+        formats[entry.substr(0, colon)] = {entry.substr(colon + 1) == "c" ? Format::Compressed : Format::Dense};
+    }
+    return formats;
+}
+
+}  // namespace
+
+std::vector<FormatMap> candidate_formats(const Assignment &assignment, const FormatMap &formats) {
+    const std::vector<std::string> arg_list = get_arg_list(lower(assignment), formats);
+    const size_t operands = arg_list.size() - 1;
+    assert(operands <= autotune_max_operands);
+
+    std::vector<FormatMap> candidates;
+    for (uint64_t mask = 0; mask < (uint64_t(1) << operands); mask++) {
+        FormatMap candidate = {{arg_list[0], {format_of(formats, arg_list[0])}}};
+        for (size_t k = 0; k < operands; k++) {
+            candidate[arg_list[k + 1]] = {(mask & (uint64_t(1) << k)) ? Format::Compressed : Format::Dense};
+        }
+        candidates.push_back(candidate);
+    }
+    return candidates;
+}
+
+bool time_formats(const Assignment &assignment, const FormatMap &formats, const FormatSample &sample, double &seconds) {
+    const std::vector<std::string> arg_list = get_arg_list(lower(assignment), formats);
+    assert(format_of(sample.formats, arg_list[0]) == Format::Dense);
+
+    const std::string data_file = make_temporary_file();
+    const std::string kernel_file = make_temporary_file();
+    const std::string harness_file = make_temporary_file();
+    write_sample(data_file, arg_list, sample);
+    compile(assignment, formats, kernel_file);
+    write_harness(harness_file, data_file, arg_list, formats, sample);
+
+    const std::string command = "./run_test.sh " + kernel_file + " " + harness_file;
+    FILE *output = popen(command.c_str(), "r");
+    bool measured = false;
+    if (output != nullptr) {
+        char line[256];
+        while (fgets(line, sizeof(line), output) != nullptr) {
+            measured |= sscanf(line, "seconds %lf", &seconds) == 1;
+        }
+        // The harness failed to build or run.
+        measured &= pclose(output) == 0;
+    }
+    std::remove(data_file.c_str());
+    std::remove(kernel_file.c_str());
+    std::remove(harness_file.c_str());
+    return measured && seconds >= 0;
+}
+
+FormatMap autotune_formats(const Assignment &assignment, const FormatSample &sample, const std::string &cache_file) {
+    const std::string key = autotune_key(assignment, sample);
+    std::ifstream cached(cache_file);
+    std::string line;
+    while (std::getline(cached, line)) {
+        const size_t tab = line.find('\t');
+        if (tab != std::string::npos && line.substr(0, tab) == key) {
+            return parse_formats(line.substr(tab + 1));
+        }
+    }
+    cached.close();
+
+    FormatMap best;
+    double best_seconds = 0;
+    for (const auto &candidate : candidate_formats(assignment, sample.formats)) {
+        double seconds = 0;
+        if (!time_formats(assignment, candidate, sample, seconds)) {
+            std::cerr << "autotune_formats: skipping " << print_formats(candidate) << ", which failed to build or run\n";
+            continue;
+        }
+        if (best.empty() || seconds < best_seconds) {
+            best = candidate;
+            best_seconds = seconds;
+        }
+    }
+    // Nothing was measured, so there is no winner to persist.
+    if (best.empty()) {
+        return sample.formats;
+    }
+
+    std::ofstream persisted(cache_file, std::ios::app);
+    persisted << key << "\t" << print_formats(best) << "\n";
+    return best;
+}
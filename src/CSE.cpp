@@ -0,0 +1,162 @@
+#include "CSE.h"
+
+#include <algorithm>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "IRVisitor.h"
+
+namespace {
+
+// Assigns every subexpression a value number; structurally equal ones share
+// a number.
+struct ValueNumbering : public IRVisitor {
+    std::map<std::string, size_t> numbers;
+    std::map<const LIR::ExprNode *, size_t> number_of;
+    // How many distinct values (or assignments) use each value.
+    std::vector<size_t> uses;
+    // Whether a value is worth keeping in a local when it is reused.
+    std::vector<bool> reusable;
+    size_t number = 0;
+
+    size_t get_number(const LIR::Expr &expr) {
+        expr.accept(this);
+        number_of[expr.ptr.get()] = number;
+        return number;
+    }
+
+    // Number the value with key, whose operands are operands.
+    void define(const std::string &key, const std::vector<size_t> &operands, const bool _reusable) {
+        auto [it, inserted] = numbers.emplace(key, uses.size());
+        number = it->second;
+        if (inserted) {
+            uses.push_back(0);
+            reusable.push_back(_reusable);
+            for (const size_t operand : operands) {
+                uses[operand]++;
+            }
+        }
+    }
+
+    template<typename T>
+    void visit_commutative(const T *node, const std::string &op) {
+        size_t a = get_number(node->a);
+        size_t b = get_number(node->b);
+        if (b < a) {
+            std::swap(a, b);
+        }
+        define(op + " " + std::to_string(a) + " " + std::to_string(b), {a, b}, true);
+    }
+
+    void visit(const LIR::ArrayAccess *node) override {
+        define("load " + node->array.name, {}, true);
+    }
+    void visit(const LIR::Literal *node) override {
+        std::ostringstream key;
+        key << "literal " << std::hexfloat << node->value;
+        define(key.str(), {}, false);
+    }
+    void visit(const LIR::Var *node) override {
+        define("var " + node->name, {}, false);
+    }
+    void visit(const LIR::Add *node) override {
+        visit_commutative(node, "add");
+    }
+    void visit(const LIR::Mul *node) override {
+        visit_commutative(node, "mul");
+    }
+
+    // Anything else (e.g. a Select, which only evaluates one operand) is
+    // left alone: a distinct value that is never hoisted.
+    void visit(const LIR::Select *) override {
+        define("opaque " + std::to_string(uses.size()), {}, false);
+    }
+    void visit(const LIR::And *) override {
+        define("opaque " + std::to_string(uses.size()), {}, false);
+    }
+    void visit(const LIR::Or *) override {
+        define("opaque " + std::to_string(uses.size()), {}, false);
+    }
+};
+
+// Rebuilds expressions, replacing reused values by locals.
+struct Rewriter {
+    const ValueNumbering &numbering;
+    std::vector<LIR::Expr> locals;
+    std::vector<LIR::Stmt> definitions;
+
+    Rewriter(const ValueNumbering &numbering)
+        : numbering(numbering), locals(numbering.uses.size()) {}
+
+    LIR::Expr rewrite(const LIR::Expr &expr) {
+        const size_t number = numbering.number_of.at(expr.ptr.get());
+        if (locals[number].defined()) {
+            return locals[number];
+        }
+
+        LIR::Expr rewritten = expr;
+        switch (expr.ptr->kind) {
+        case LIR::ExprKind::Add: {
+            auto add = expr.as<LIR::Add>();
+            LIR::Expr a = rewrite(add->a);
+            rewritten = LIR::Add::make(a, rewrite(add->b));
+            break;
+        }
+        case LIR::ExprKind::Mul: {
+            auto mul = expr.as<LIR::Mul>();
+            LIR::Expr a = rewrite(mul->a);
+            rewritten = LIR::Mul::make(a, rewrite(mul->b));
+            break;
+        }
+        default:
+            break;
+        }
+
+        if (numbering.reusable[number] && numbering.uses[number] > 1) {
+            const std::string name = "cse_t" + std::to_string(definitions.size());
+            definitions.push_back(LIR::VarDefinition::make(name, LIR::ScalarType::Float, rewritten));
+            locals[number] = LIR::Var::make(name);
+            return locals[number];
+        }
+        return rewritten;
+    }
+};
+
+}  // namespace
+
+LIR::Stmt eliminate_common_subexpressions(const LIR::Stmt &body) {
+    std::vector<std::shared_ptr<const LIR::ArrayAssignment>> assignments;
+    if (auto sequence = body.as<LIR::SequenceStmt>()) {
+        for (const auto &stmt : sequence->stmts) {
+            assignments.push_back(stmt.as<LIR::ArrayAssignment>());
+        }
+    } else {
+        assignments.push_back(body.as<LIR::ArrayAssignment>());
+    }
+    if (std::find(assignments.cbegin(), assignments.cend(), nullptr) != assignments.cend()) {
+        return body;
+    }
+
+    ValueNumbering numbering;
+    for (const auto &assignment : assignments) {
+        numbering.uses[numbering.get_number(assignment->value)]++;
+    }
+    bool reused = false;
+    for (size_t number = 0; number < numbering.uses.size(); number++) {
+        reused |= numbering.reusable[number] && numbering.uses[number] > 1;
+    }
+    if (!reused) {
+        return body;
+    }
+
+    Rewriter rewriter(numbering);
+    std::vector<LIR::Stmt> rewritten;
+    for (const auto &assignment : assignments) {
+        rewritten.push_back(LIR::ArrayAssignment::make(assignment->array, rewriter.rewrite(assignment->value),
+                                                       assignment->accumulate));
+    }
+    rewritten.insert(rewritten.begin(), rewriter.definitions.cbegin(), rewriter.definitions.cend());
+    return LIR::SequenceStmt::make(rewritten);
+}
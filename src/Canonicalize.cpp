@@ -0,0 +1,63 @@
+#include "Canonicalize.h"
+
+#include <sstream>
+
+#include "GatherIteratorSet.h"
+#include "IRPrinter.h"
+#include "IRVisitor.h"
+#include "Lower.h"
+
+namespace {
+
+struct CanonicalizeExpr : public IRVisitor {
+    Expr expr;
+    // Printed form of expr.
+    std::string key;
+
+    template<typename T>
+    void visit_commutative(const T *node, const std::string &op) {
+        node->a.accept(this);
+        Expr a = std::move(expr);
+        std::string key_a = std::move(key);
+        node->b.accept(this);
+        Expr b = std::move(expr);
+        std::string key_b = std::move(key);
+        if (key_b < key_a) {
+            std::swap(a, b);
+            std::swap(key_a, key_b);
+        }
+        expr = T::make(a, b);
+        key = "(" + key_a + " " + op + " " + key_b + ")";
+    }
+
+    void visit(const ArrayRead *arrayread) override {
+        expr = ArrayRead::make(arrayread->access);
+        std::ostringstream printed;
+        printed << expr;
+        key = printed.str();
+    }
+    void visit(const Add *add) override {
+        visit_commutative(add, "+");
+    }
+    void visit(const Mul *mul) override {
+        visit_commutative(mul, "*");
+    }
+};
+
+}  // namespace
+
+Assignment canonicalize(const Assignment &assignment) {
+    CanonicalizeExpr canonicalizer;
+    assignment.rhs.accept(&canonicalizer);
+    return Assignment(assignment.access, canonicalizer.expr);
+}
+
+std::string kernel_cache_key(const Assignment &assignment, const FormatMap &formats) {
+    const Assignment canonical = canonicalize(assignment);
+    std::ostringstream key;
+    key << canonical;
+    for (const auto &array : gather_iterator_set(lower(canonical), formats).iterators) {
+        key << " " << array.name << ":" << (array.format == Format::Compressed ? "c" : "d");
+    }
+    return key.str();
+}
@@ -0,0 +1,393 @@
+#include "CostModel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "IRVisitor.h"
+
+namespace {
+
+// Operations of a step of a k-way merge (see runtime/merge.h), besides
+// testing whether each operand is present, and of each level of the heap an
+// advanced operand sifts through: two comparisons with tie breaks, and moves
+// of heap entries.
+constexpr double heap_step_operations = 4;
+constexpr double heap_level_operations = 8;
+
+struct CostEstimator : public IRVisitor {
+    const OperandStatsMap &stats;
+    // Extent of the coordinate space.
+    double extent = 1;
+
+    KernelCost cost;
+    // How many times the statement being visited runs.
+    double frequency = 1;
+    // Iterators of the innermost loop, and the probability that at least one
+    // of them is present at a coordinate, i.e. the fraction of coordinates
+    // the loop visits.
+    std::vector<LIR::ArrayLevel> loop;
+    double loop_density = 1;
+    // Coordinates covered by the loops already run in this scope. Loops run
+    // after another over the coordinates left (see lower_merge).
+    double covered = 0;
+    // Probability that each boolean local (e.g. a_present) is true.
+    std::map<std::string, double> probabilities;
+
+    explicit CostEstimator(const OperandStatsMap &stats)
+        : stats(stats) {
+        for (const auto &[name, s] : stats) {
+            extent = std::max(extent, double(s.extent));
+        }
+    }
+
+    double density(const LIR::ArrayLevel &level) const {
+        auto s = stats.find(level.name);
+        if (level.format == Format::Dense || s == stats.end() || s->second.extent == 0) {
+            return 1;
+        }
+        return std::min(1.0, double(s->second.nnz) / double(s->second.extent));
+    }
+
+    // Expected coordinate at which level runs out: just after its last nonzero.
+    double end(const LIR::ArrayLevel &level) const {
+        auto s = stats.find(level.name);
+        if (level.format == Format::Dense || s == stats.end()) {
+            return extent;
+        }
+        const double nnz = double(s->second.nnz);
+        return extent * nnz / (nnz + 1);
+    }
+
+    double nnz(const LIR::ArrayLevel &level) const {
+        return extent * density(level);
+    }
+
+    // Probability that at least one of levels is present.
+    double union_density(const std::vector<LIR::ArrayLevel> &levels) const {
+        double absent = 1;
+        for (const auto &level : levels) {
+            absent *= 1 - density(level);
+        }
+        return 1 - absent;
+    }
+
+    // Probability, at a step of the current loop, that exactly the iterators
+    // of present are present.
+    double exactly(const std::vector<LIR::ArrayLevel> &present) const {
+        double p = 1;
+        for (const auto &level : loop) {
+            const bool in = std::any_of(present.cbegin(), present.cend(),
+                                        [&](const LIR::ArrayLevel &l) { return l.name == level.name; });
+            p *= in ? density(level) : 1 - density(level);
+        }
+        return loop_density > 0 ? std::min(1.0, p / loop_density) : 0;
+    }
+
+    // Probability that the boolean expression expr is true.
+    double probability(const LIR::Expr &expr) const {
+        if (auto var = expr.as<LIR::Var>()) {
+            auto p = probabilities.find(var->name);
+            return p != probabilities.end() ? p->second : 1;
+        }
+        if (auto a = expr.as<LIR::And>()) {
+            return probability(a->a) * probability(a->b);
+        }
+        if (auto o = expr.as<LIR::Or>()) {
+            const double pa = probability(o->a);
+            const double pb = probability(o->b);
+            return pa + pb - pa * pb;
+        }
+        return 1;
+    }
+
+    void operations(const double count) {
+        cost.operations += frequency * count;
+    }
+    void bytes(const double count) {
+        cost.bytes += frequency * count;
+    }
+
+    // Visit body as the body of a loop over iterators, taking trips steps.
+    void visit_loop(const std::vector<LIR::ArrayLevel> &iterators, const double trips, const LIR::Stmt &body) {
+        const double outer_frequency = frequency;
+        const auto outer_loop = loop;
+        const double outer_density = loop_density;
+        frequency *= trips;
+        loop = iterators;
+        loop_density = union_density(iterators);
+        body.accept(this);
+        frequency = outer_frequency;
+        loop = outer_loop;
+        loop_density = outer_density;
+    }
+
+    // Coordinates a loop that ends when the first of iterators runs out
+    // visits, after the loops before it.
+    double range(const std::vector<LIR::ArrayLevel> &iterators) {
+        double loop_end = extent;
+        for (const auto &level : iterators) {
+            loop_end = std::min(loop_end, end(level));
+        }
+        const double begin = covered;
+        covered = std::max(covered, loop_end);
+        return std::max(0.0, loop_end - begin);
+    }
+
+    void visit(const LIR::ArrayAccess *) override {
+        bytes(sizeof(float));
+    }
+    void visit(const LIR::Select *node) override {
+        operations(1);
+        IRVisitor::visit(node);
+    }
+    void visit(const LIR::And *node) override {
+        operations(1);
+        IRVisitor::visit(node);
+    }
+    void visit(const LIR::Or *node) override {
+        operations(1);
+        IRVisitor::visit(node);
+    }
+    void visit(const LIR::Add *node) override {
+        operations(1);
+        IRVisitor::visit(node);
+    }
+    void visit(const LIR::Mul *node) override {
+        operations(1);
+        IRVisitor::visit(node);
+    }
+
+    void visit(const LIR::BlockStmt *node) override {
+        const double outer_covered = covered;
+        covered = 0;
+        node->body.accept(this);
+        covered = outer_covered;
+    }
+
+    void visit(const LIR::WhileStmt *node) override {
+        const auto &iterators = node->condition.iterators;
+        const double trips = range(iterators) * union_density(iterators);
+        // The loop condition, once per step.
+        operations(trips * iterators.size());
+        visit_loop(iterators, trips, node->body);
+    }
+
+    void visit(const LIR::ForStmt *node) override {
+        auto s = stats.find(node->bound.name);
+        const double trips = s != stats.end() ? double(s->second.extent) : extent;
+        operations(trips);
+        visit_loop(node->arrays.iterators, trips, node->body);
+    }
+
+    void visit(const LIR::IfStmt *node) override {
+        // Cases are tested in order, until one is taken.
+        double reached = 1;
+        for (size_t i = 0; i < node->conditions.size(); i++) {
+            const auto &condition = node->conditions[i].iterators;
+            operations(reached * condition.size());
+            const double taken = std::min(reached, exactly(condition));
+            const double outer_frequency = frequency;
+            frequency *= taken;
+            node->bodies[i].accept(this);
+            frequency = outer_frequency;
+            reached -= taken;
+        }
+    }
+
+    void visit(const LIR::SwitchStmt *node) override {
+        const auto &iterators = node->iterators.iterators;
+        // One comparison per bit of the mask, and the jump.
+        operations(iterators.size() + 1);
+        for (size_t i = 0; i < node->bodies.size(); i++) {
+            double taken = 0;
+            for (const uint64_t mask : node->cases[i]) {
+                std::vector<LIR::ArrayLevel> present;
+                for (size_t k = 0; k < iterators.size(); k++) {
+                    if (mask & (uint64_t(1) << k)) {
+                        present.push_back(iterators[k]);
+                    }
+                }
+                taken += exactly(present);
+            }
+            const double outer_frequency = frequency;
+            frequency *= std::min(1.0, taken);
+            node->bodies[i].accept(this);
+            frequency = outer_frequency;
+        }
+    }
+
+    void visit(const LIR::VarDefinition *node) override {
+        node->value.accept(this);
+        if (node->type == LIR::ScalarType::Bool) {
+            probabilities[node->name] = probability(node->value);
+        }
+    }
+
+    void visit(const LIR::KWayMergeStmt *node) override {
+        const auto &iterators = node->iterators.iterators;
+        // Runs until every iterator runs out.
+        double loop_end = 0;
+        for (const auto &level : iterators) {
+            loop_end = std::max(loop_end, end(level));
+        }
+        const double trips = std::max(0.0, loop_end - covered) * union_density(iterators);
+        covered = std::max(covered, loop_end);
+
+        const double outer_frequency = frequency;
+        const auto outer_loop = loop;
+        const double outer_density = loop_density;
+        frequency *= trips;
+        loop = iterators;
+        loop_density = union_density(iterators);
+
+        // Each step pops the iterators at the smallest coordinate, and pushes
+        // them back after reading their next coordinate.
+        double advanced = 0;
+        for (const auto &level : iterators) {
+            const double present = loop_density > 0 ? density(level) / loop_density : 0;
+            probabilities[level.name + "_present"] = std::min(1.0, present);
+            advanced += present;
+        }
+        const double levels = std::max(1.0, std::log2(double(iterators.size())));
+        operations(heap_step_operations + 2 * iterators.size() + heap_level_operations * advanced * levels);
+        bytes(advanced * sizeof(uint64_t));
+
+        node->definitions.accept(this);
+        node->guard.accept(this);
+        frequency *= probability(node->guard);
+        node->body.accept(this);
+
+        frequency = outer_frequency;
+        loop = outer_loop;
+        loop_density = outer_density;
+    }
+
+    void visit(const LIR::GallopStmt *node) override {
+        std::vector<LIR::ArrayLevel> iterators = node->others.iterators;
+        iterators.push_back(node->lead);
+        const double trips = range(iterators) * density(node->lead);
+        // The loop condition, and reading the lead's coordinate.
+        operations(2 * trips);
+        bytes(trips * sizeof(uint64_t));
+
+        const double outer_frequency = frequency;
+        frequency *= trips;
+        // Each other iterator gallops over the positions between two
+        // coordinates of the lead, testing about twice the log of that many.
+        double present = 1;
+        for (const auto &level : node->others.iterators) {
+            const double probes = 2 * std::log2(nnz(level) / std::max(1.0, nnz(node->lead)) + 1) + 1;
+            operations(2 * probes + 2);
+            bytes(probes * sizeof(uint64_t));
+            present *= density(level);
+        }
+        frequency *= present;
+        node->body.accept(this);
+        frequency = outer_frequency;
+    }
+
+    void visit(const LIR::DenseLocateStmt *node) override {
+        const auto &iterators = node->iterators.iterators;
+        auto s = stats.find(node->bound.name);
+        const double trips = s != stats.end() ? double(s->second.extent) : extent;
+        covered = std::max(covered, trips);
+        // The loop condition, and testing and advancing every iterator.
+        operations(trips * (1 + 3 * iterators.size()));
+        bytes(trips * iterators.size() * sizeof(uint64_t));
+
+        const double outer_frequency = frequency;
+        frequency *= trips;
+        for (const auto &level : iterators) {
+            probabilities[level.name + "_present"] = density(level);
+        }
+        node->definitions.accept(this);
+        node->guard.accept(this);
+        frequency *= probability(node->guard);
+        node->body.accept(this);
+        frequency = outer_frequency;
+    }
+
+    void visit(const LIR::DenseRunStmt *node) override {
+        // The run test, at every step; runs themselves are assumed rare.
+        operations(2 * node->iterators.iterators.size());
+    }
+
+    void visit(const LIR::InterleavedLoopStmt *node) override {
+        const std::vector<LIR::ArrayLevel> iterators = {node->iterator};
+        const double trips = range(iterators) * density(node->iterator);
+        // Stream selection and bounds, once per step.
+        operations(2 * trips);
+        visit_loop(iterators, trips, node->body);
+    }
+
+    // Locating the bounds of parts partitions in each compressed operand.
+    void locate(const std::vector<LIR::ArrayLevel> &compressed, const double parts) {
+        for (const auto &level : compressed) {
+            operations(2 * parts * std::log2(nnz(level) + 1));
+        }
+    }
+
+    void visit(const LIR::PartitionedForStmt *node) override {
+        const auto &compressed = node->compressed.iterators;
+        double parts = 1;
+        if (node->grain != 0) {
+            double work = extent;
+            if (node->partitioning == LIR::Partitioning::Nonzeros) {
+                work = 0;
+                for (const auto &level : compressed) {
+                    work = std::max(work, nnz(level));
+                }
+            }
+            parts = std::max(1.0, std::ceil(work / double(node->grain)));
+        }
+        locate(compressed, parts);
+        node->body.accept(this);
+    }
+
+    void visit(const LIR::ShardStmt *node) override {
+        locate(node->compressed.iterators, 1);
+        node->body.accept(this);
+    }
+
+    void visit(const LIR::IncrementIterator *node) override {
+        const bool compare = node->array.format == Format::Compressed && !node->always;
+        operations(compare ? 2 : 1);
+    }
+
+    void visit(const LIR::CompressedIndexDefinition *) override {
+        operations(1);
+        bytes(sizeof(uint64_t));
+    }
+
+    void visit(const LIR::LogicalIndexDefinition *node) override {
+        operations(node->iterators.iterators.size());
+    }
+
+    void visit(const LIR::IteratorDefinition *node) override {
+        operations(node->iterators.iterators.size());
+    }
+
+    void visit(const LIR::ArrayAssignment *node) override {
+        node->value.accept(this);
+        bytes(sizeof(float));
+        if (node->accumulate) {
+            operations(1);
+            bytes(sizeof(float));
+        }
+    }
+};
+
+}  // namespace
+
+double KernelCost::total() const {
+    return operations + bytes / cost_bytes_per_operation;
+}
+
+KernelCost estimate_cost(const LIR::Stmt &stmt, const OperandStatsMap &stats) {
+    CostEstimator estimator(stats);
+    stmt.accept(&estimator);
+    return estimator.cost;
+}
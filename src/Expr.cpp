@@ -1,5 +1,28 @@
 #include "Expr.h"
 #include "IRVisitor.h"
+#include "Intern.h"
+
+namespace {
+
+InternTable<ExprNode> &expr_table() {
+    static InternTable<ExprNode> table;
+    return table;
+}
+
+uint64_t id_of(const Expr &expr) {
+    return expr.defined() ? expr.ptr->id : 0;
+}
+
+template<typename T>
+std::shared_ptr<const T> make_binop(Expr a, Expr b) {
+    return expr_table().get<T>(InternKey{int(T::node_kind), "", id_of(a), id_of(b)}, [&] {
+        auto node = std::make_shared<T>(a, b);
+        node->kind = T::node_kind;
+        return node;
+    });
+}
+
+}  // namespace
 
 void Expr::accept(IRVisitor *v) const {
     ptr->accept(v);
@@ -19,11 +42,15 @@ void ArrayRead::accept(IRVisitor *v) const {
 }
 
 const std::shared_ptr<const ArrayRead> ArrayRead::make(const Access &_access) {
-    return std::make_shared<ArrayRead>(_access);
+    return expr_table().get<ArrayRead>(InternKey{int(ExprKind::ArrayRead), intern_name(_access)}, [&] {
+        auto node = std::make_shared<ArrayRead>(_access);
+        node->kind = ExprKind::ArrayRead;
+        return node;
+    });
 }
 
 const std::shared_ptr<const Add> Add::make(Expr _a, Expr _b) {
-    return std::make_shared<Add>(_a, _b);
+    return make_binop<Add>(_a, _b);
 }
 
 void Add::accept(IRVisitor *v) const {
@@ -31,7 +58,7 @@ void Add::accept(IRVisitor *v) const {
 }
 
 const std::shared_ptr<const Mul> Mul::make(Expr _a, Expr _b) {
-    return std::make_shared<Mul>(_a, _b);
+    return make_binop<Mul>(_a, _b);
 }
 
 void Mul::accept(IRVisitor *v) const {
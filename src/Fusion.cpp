@@ -0,0 +1,59 @@
+#include "Fusion.h"
+
+#include <cassert>
+#include <map>
+#include <string>
+
+#include "IRVisitor.h"
+
+namespace {
+
+// Rebuild an expression, replacing the reads of temporaries by their
+// definitions.
+struct Substitute : public IRVisitor {
+    const std::map<std::string, Expr> &definitions;
+    Expr substituted;
+
+    Substitute(const std::map<std::string, Expr> &definitions)
+        : definitions(definitions) {}
+
+    void visit(const ArrayRead *arrayread) override {
+        auto definition = definitions.find(arrayread->access.name);
+        if (definition != definitions.end()) {
+            substituted = definition->second;
+        } else {
+            substituted = ArrayRead::make(arrayread->access);
+        }
+    }
+    void visit(const Add *add) override {
+        add->a.accept(this);
+        auto lhs = std::move(substituted);
+        add->b.accept(this);
+        substituted = Add::make(lhs, substituted);
+    }
+    void visit(const Mul *mul) override {
+        mul->a.accept(this);
+        auto lhs = std::move(substituted);
+        mul->b.accept(this);
+        substituted = Mul::make(lhs, substituted);
+    }
+};
+
+}  // namespace
+
+Assignment fuse(const std::vector<Assignment> &pipeline) {
+    assert(!pipeline.empty());
+    // Definitions of the temporaries in terms of the pipeline's inputs. A
+    // temporary that is assigned again is replaced by its latest definition.
+    std::map<std::string, Expr> definitions;
+    for (auto it = pipeline.cbegin(); it != pipeline.cend() - 1; it++) {
+        Substitute substitute(definitions);
+        it->rhs.accept(&substitute);
+        definitions[it->access.name] = substitute.substituted;
+    }
+
+    const Assignment &last = pipeline.back();
+    Substitute substitute(definitions);
+    last.rhs.accept(&substitute);
+    return Assignment(last.access, substitute.substituted);
+}
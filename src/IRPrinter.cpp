@@ -160,6 +160,27 @@ void IRPrinter::visit(const ForAll *op) {
     print_indent();
     stream << "∀ ";
     print(op->sexpr);
+
+    const Schedule &schedule = op->schedule;
+    if (schedule.split_factor != 0) {
+        stream << (schedule.position_operand.empty() ? " split(" : " split_pos(");
+        if (!schedule.position_operand.empty()) {
+            stream << schedule.position_operand << ", ";
+        }
+        stream << schedule.outer << ", " << schedule.inner << ", " << schedule.split_factor << ")";
+    }
+    if (!schedule.parallel.empty()) {
+        stream << " parallelize(" << schedule.parallel << ")";
+    }
+    if (schedule.vectorize_width != 0) {
+        stream << " vectorize(" << schedule.vectorize_width << ")";
+    }
+    if (schedule.unroll_count != 0) {
+        stream << " unroll(" << schedule.unroll_count << ")";
+    }
+    if (schedule.interleave_streams != 0) {
+        stream << " interleave(" << schedule.interleave_streams << ")";
+    }
     stream << " {\n";
 
     indent += 2;
@@ -178,6 +199,12 @@ void IRPrinter::visit(const ArrayAssignment *op) {
     stream << "\n";
 }
 
+void IRPrinter::visit(const Multi *op) {
+    for (const auto &stmt : op->stmts) {
+        print(stmt);
+    }
+}
+
 
 void print_iterator(std::ostream &stream, const LIR::ArrayLevel array) {
     stream << array.name;
@@ -200,8 +227,16 @@ void print_logical_index(std::ostream &stream) {
     stream << "i";
 }
 
-void print_iterator_bound(std::ostream &stream, const LIR::ArrayLevel array, const bool upper) {
-    if (array.format == Format::Compressed) {
+void print_iterator_bound(std::ostream &stream, const LIR::ArrayLevel array, const bool upper, const bool partitioned) {
+    if (partitioned) {
+        // Bounds of the current partition, defined by an enclosing PartitionedForStmt.
+        if (array.format == Format::Compressed) {
+            print_iterator(stream, array);
+        } else {
+            print_logical_index(stream);
+        }
+        stream << (upper ? "_part_end" : "_part_begin");
+    } else if (array.format == Format::Compressed) {
         stream << array.name;
         if (upper) {
             stream << ".pos[1]";
@@ -219,9 +254,18 @@ void print_iterator_bound(std::ostream &stream, const LIR::ArrayLevel array, con
     }
 }
 
-void print_array_access(std::ostream &stream, const LIR::ArrayLevel array) {
-    stream << array.name;
-    stream << ".values[";
+void print_hoisted_values(std::ostream &stream, const LIR::ArrayLevel array) {
+    stream << array.name << "_vals";
+}
+
+void print_array_access(std::ostream &stream, const LIR::ArrayLevel array, const bool hoisted) {
+    if (hoisted) {
+        print_hoisted_values(stream, array);
+        stream << "[";
+    } else {
+        stream << array.name;
+        stream << ".values[";
+    }
     if (array.format == Format::Dense) {
         // Use logical index if reading/writing a dense array.
         print_logical_index(stream);
@@ -252,7 +296,7 @@ void print_set_guard(std::ostream &stream, const LIR::IteratorSet &guard) {
     }
 }
 
-void print_bounded_guard(std::ostream &stream, const LIR::IteratorSet &guard) {
+void print_bounded_guard(std::ostream &stream, const LIR::IteratorSet &guard, const bool partitioned) {
     for (size_t i = 0; i < guard.iterators.size(); i++) {
         if (i != 0) {
             stream << " && ";
@@ -261,13 +305,39 @@ void print_bounded_guard(std::ostream &stream, const LIR::IteratorSet &guard) {
         stream << "(";
         print_iterator(stream, it);
         stream << " < ";
-        print_iterator_bound(stream, it, true);
+        print_iterator_bound(stream, it, true, partitioned);
         stream << ")";
     }
 }
 
 void IRPrinter::visit(const LIR::ArrayAccess *op) {
-    print_array_access(stream, op->array);
+    print_array_access(stream, op->array, hoisted.count(op->array.name) != 0);
+}
+
+void IRPrinter::visit(const LIR::Literal *op) {
+    stream << op->value << "f";
+}
+
+void IRPrinter::visit(const LIR::Var *op) {
+    stream << op->name;
+}
+
+void IRPrinter::visit(const LIR::Select *op) {
+    open();
+    print(op->cond);
+    stream << " ? ";
+    print(op->a);
+    stream << " : ";
+    print(op->b);
+    close();
+}
+
+void IRPrinter::visit(const LIR::And *op) {
+    print_binop(op, "&&");
+}
+
+void IRPrinter::visit(const LIR::Or *op) {
+    print_binop(op, "||");
 }
 
 void IRPrinter::visit(const LIR::Add *op) {
@@ -284,10 +354,34 @@ void IRPrinter::visit(const LIR::SequenceStmt *node) {
     }
 }
 
+void IRPrinter::visit(const LIR::BlockStmt *op) {
+    print_indent();
+    stream << "{\n";
+
+    indent += 2;
+    print(op->body);
+    indent -= 2;
+
+    print_indent();
+    stream << "}\n";
+}
+
+void IRPrinter::print_loop_hints(const LIR::LoopHints &hints) {
+    if (hints.vectorize_width != 0) {
+        print_indent();
+        stream << "#pragma clang loop vectorize(enable) vectorize_width(" << hints.vectorize_width << ")\n";
+    }
+    if (hints.unroll_count != 0) {
+        print_indent();
+        stream << "#pragma clang loop unroll_count(" << hints.unroll_count << ")\n";
+    }
+}
+
 void IRPrinter::visit(const LIR::WhileStmt *op) {
+    print_loop_hints(op->hints);
     print_indent();
     stream << "while (";
-    print_bounded_guard(stream, op->condition);
+    print_bounded_guard(stream, op->condition, partitioned);
     stream << ") {\n";
 
     indent += 2;
@@ -298,6 +392,54 @@ void IRPrinter::visit(const LIR::WhileStmt *op) {
     stream << "}\n";
 }
 
+void IRPrinter::visit(const LIR::ForStmt *op) {
+    print_indent();
+    stream << "{\n";
+    indent += 2;
+
+    for (const auto &array : op->arrays.iterators) {
+        print_indent();
+        stream << "float *__restrict ";
+        print_hoisted_values(stream, array);
+        stream << " = " << array.name << ".values;\n";
+        hoisted.insert(array.name);
+    }
+    print_indent();
+    stream << "const uint64_t ";
+    print_logical_index(stream);
+    stream << "_end = ";
+    print_iterator_bound(stream, op->bound, true, partitioned);
+    stream << ";\n";
+
+    print_loop_hints(op->hints);
+    print_indent();
+    stream << "for (uint64_t ";
+    print_logical_index(stream);
+    stream << " = ";
+    print_iterator_bound(stream, op->bound, false, partitioned);
+    stream << "; ";
+    print_logical_index(stream);
+    stream << " < ";
+    print_logical_index(stream);
+    stream << "_end; ";
+    print_logical_index(stream);
+    stream << "++) {\n";
+
+    indent += 2;
+    print(op->body);
+    indent -= 2;
+
+    print_indent();
+    stream << "}\n";
+
+    for (const auto &array : op->arrays.iterators) {
+        hoisted.erase(array.name);
+    }
+    indent -= 2;
+    print_indent();
+    stream << "}\n";
+}
+
 void IRPrinter::visit(const LIR::IfStmt *op) {
     const size_t N = op->conditions.size();
     for (size_t i = 0; i < N; i++) {
@@ -306,17 +448,662 @@ void IRPrinter::visit(const LIR::IfStmt *op) {
         if (i > 0) {
             stream << "else ";
         }
+        const LIR::BranchHint hint = op->hints.empty() ? LIR::BranchHint::None : op->hints[i];
         stream << "if (";
+        if (hint != LIR::BranchHint::None) {
+            stream << "__builtin_expect(";
+        }
         print_set_guard(stream, op->conditions[i]);
+        if (hint != LIR::BranchHint::None) {
+            stream << ", " << (hint == LIR::BranchHint::Likely ? 1 : 0) << ")";
+        }
         stream << ") {\n";
 
+        indent += 2;
+        if (hint == LIR::BranchHint::Cold) {
+            print_indent();
+            stream << "[&]() __attribute__((noinline, cold)) {\n";
+            indent += 2;
+            print(op->bodies[i]);
+            indent -= 2;
+            print_indent();
+            stream << "}();\n";
+        } else {
+            print(op->bodies[i]);
+        }
+        indent -= 2;
+
+        print_indent();
+        stream << "}\n";
+    }
+}
+
+void IRPrinter::visit(const LIR::SwitchStmt *op) {
+    const auto &iterators = op->iterators.iterators;
+
+    print_indent();
+    stream << "uint64_t ";
+    print_logical_index(stream);
+    stream << "_mask = ";
+    for (size_t i = 0; i < iterators.size(); i++) {
+        if (i != 0) {
+            stream << " | ";
+        }
+        stream << "((uint64_t)(";
+        print_resolved_index(stream, iterators[i]);
+        stream << " == ";
+        print_logical_index(stream);
+        stream << ") << " << i << ")";
+    }
+    stream << ";\n";
+
+    print_indent();
+    stream << "switch (";
+    print_logical_index(stream);
+    stream << "_mask) {\n";
+    indent += 2;
+    for (size_t i = 0; i < op->bodies.size(); i++) {
+        for (size_t j = 0; j < op->cases[i].size(); j++) {
+            print_indent();
+            stream << "case " << op->cases[i][j] << ":";
+            stream << ((j + 1 < op->cases[i].size()) ? "\n" : " {\n");
+        }
+
         indent += 2;
         print(op->bodies[i]);
+        print_indent();
+        stream << "break;\n";
         indent -= 2;
 
         print_indent();
         stream << "}\n";
     }
+    indent -= 2;
+    print_indent();
+    stream << "}\n";
+}
+
+void IRPrinter::visit(const LIR::VarDefinition *op) {
+    print_indent();
+    stream << ((op->type == LIR::ScalarType::Bool) ? "const bool " : "const float ");
+    stream << op->name << " = ";
+    print(op->value);
+    stream << ";\n";
+}
+
+void IRPrinter::visit(const LIR::KWayMergeStmt *op) {
+    const auto &iterators = op->iterators.iterators;
+    const size_t K = iterators.size();
+
+    auto print_initializer = [&](const std::string &type, const std::string &name, auto print_element) {
+        print_indent();
+        stream << type << " merge_" << name << "[" << K << "] = {";
+        for (size_t k = 0; k < K; k++) {
+            if (k != 0) {
+                stream << ", ";
+            }
+            print_element(iterators[k]);
+        }
+        stream << "};\n";
+    };
+
+    print_indent();
+    stream << "{\n";
+    indent += 2;
+
+    print_initializer("const uint64_t *", "crd", [&](const LIR::ArrayLevel &it) { stream << it.name << ".crd"; });
+    print_initializer("const uint64_t", "end", [&](const LIR::ArrayLevel &it) { print_iterator_bound(stream, it, true, partitioned); });
+    print_initializer("uint64_t", "pos", [&](const LIR::ArrayLevel &it) { print_iterator_bound(stream, it, false, partitioned); });
+    print_initializer("uint64_t", "at", [&](const LIR::ArrayLevel &it) { print_iterator_bound(stream, it, false, partitioned); });
+    print_initializer("uint64_t", "hit", [&](const LIR::ArrayLevel &) { stream << "0"; });
+    print_indent();
+    stream << "uint64_t merge_step = 0;\n";
+    print_indent();
+    stream << "kway_heap<" << K << "> merge_heap;\n";
+    print_indent();
+    stream << "for (uint64_t k = 0; k < " << K << "; k++) {\n";
+    print_indent();
+    stream << "  if (merge_pos[k] < merge_end[k]) merge_heap.push(merge_crd[k][merge_pos[k]], k);\n";
+    print_indent();
+    stream << "}\n";
+
+    print_indent();
+    stream << "while (!merge_heap.empty()) {\n";
+    indent += 2;
+
+    print_indent();
+    stream << "const uint64_t ";
+    print_logical_index(stream);
+    stream << " = merge_heap.top_crd();\n";
+    print_indent();
+    stream << "merge_step++;\n";
+    print_indent();
+    stream << "do {\n";
+    print_indent();
+    stream << "  const uint64_t k = merge_heap.top_operand();\n";
+    print_indent();
+    stream << "  merge_hit[k] = merge_step;\n";
+    print_indent();
+    stream << "  merge_at[k] = merge_pos[k]++;\n";
+    print_indent();
+    stream << "  if (merge_pos[k] < merge_end[k]) merge_heap.replace_top(merge_crd[k][merge_pos[k]]);\n";
+    print_indent();
+    stream << "  else merge_heap.pop();\n";
+    print_indent();
+    stream << "} while (!merge_heap.empty() && merge_heap.top_crd() == ";
+    print_logical_index(stream);
+    stream << ");\n";
+
+    for (size_t k = 0; k < K; k++) {
+        print_indent();
+        stream << "const bool " << iterators[k].name << "_present = (merge_hit[" << k << "] == merge_step);\n";
+        print_indent();
+        stream << "const uint64_t ";
+        print_iterator(stream, iterators[k]);
+        stream << " = merge_at[" << k << "];\n";
+    }
+
+    print(op->definitions);
+    print_indent();
+    stream << "if (";
+    print(op->guard);
+    stream << ") {\n";
+    indent += 2;
+    print(op->body);
+    indent -= 2;
+    print_indent();
+    stream << "}\n";
+
+    indent -= 2;
+    print_indent();
+    stream << "}\n";
+
+    indent -= 2;
+    print_indent();
+    stream << "}\n";
+}
+
+void IRPrinter::visit(const LIR::GallopStmt *op) {
+    const auto &others = op->others.iterators;
+
+    print_indent();
+    stream << "while (";
+    print_iterator(stream, op->lead);
+    stream << " < ";
+    print_iterator_bound(stream, op->lead, true, partitioned);
+    stream << ") {\n";
+    indent += 2;
+
+    print(LIR::CompressedIndexDefinition::make(op->lead));
+    print_indent();
+    stream << "uint64_t ";
+    print_logical_index(stream);
+    stream << " = ";
+    print_derived_index(stream, op->lead);
+    stream << ";\n";
+
+    for (const auto &it : others) {
+        print_indent();
+        print_iterator(stream, it);
+        stream << " = gallop(" << it.name << ".crd, ";
+        print_iterator(stream, it);
+        stream << ", ";
+        print_iterator_bound(stream, it, true, partitioned);
+        stream << ", ";
+        print_logical_index(stream);
+        stream << ");\n";
+        print_indent();
+        stream << "if (";
+        print_iterator(stream, it);
+        stream << " == ";
+        print_iterator_bound(stream, it, true, partitioned);
+        stream << ") break;\n";
+        print(LIR::CompressedIndexDefinition::make(it));
+    }
+
+    print_indent();
+    stream << "if (";
+    print_set_guard(stream, op->others);
+    stream << ") {\n";
+    indent += 2;
+    print(op->body);
+    indent -= 2;
+    print_indent();
+    stream << "}\n";
+
+    print(LIR::IncrementIterator::make(op->lead, true));
+
+    indent -= 2;
+    print_indent();
+    stream << "}\n";
+}
+
+void IRPrinter::visit(const LIR::DenseLocateStmt *op) {
+    const auto &iterators = op->iterators.iterators;
+
+    print_indent();
+    stream << "for (uint64_t ";
+    print_logical_index(stream);
+    stream << " = ";
+    print_iterator_bound(stream, op->bound, false, partitioned);
+    stream << "; ";
+    print_logical_index(stream);
+    stream << " < ";
+    print_iterator_bound(stream, op->bound, true, partitioned);
+    stream << "; ";
+    print_logical_index(stream);
+    stream << "++) {\n";
+    indent += 2;
+
+    for (const auto &it : iterators) {
+        print_indent();
+        stream << "const bool " << it.name << "_present = (";
+        print_iterator(stream, it);
+        stream << " < ";
+        print_iterator_bound(stream, it, true, partitioned);
+        stream << ") && (" << it.name << ".crd[";
+        print_iterator(stream, it);
+        stream << "] == ";
+        print_logical_index(stream);
+        stream << ");\n";
+    }
+
+    print(op->definitions);
+    print_indent();
+    stream << "if (";
+    print(op->guard);
+    stream << ") {\n";
+    indent += 2;
+    print(op->body);
+    indent -= 2;
+    print_indent();
+    stream << "}\n";
+
+    for (const auto &it : iterators) {
+        print_indent();
+        print_iterator(stream, it);
+        stream << " += " << it.name << "_present;\n";
+    }
+
+    indent -= 2;
+    print_indent();
+    stream << "}\n";
+}
+
+void IRPrinter::visit(const LIR::DenseRunStmt *op) {
+    const auto &iterators = op->iterators.iterators;
+    const auto &first = iterators.front();
+
+    auto print_crd = [&](const LIR::ArrayLevel &it, const uint64_t offset) {
+        stream << it.name << ".crd[";
+        print_iterator(stream, it);
+        if (offset != 0) {
+            stream << " + " << offset;
+        }
+        stream << "]";
+    };
+
+    print_indent();
+    stream << "if (";
+    for (size_t i = 0; i < iterators.size(); i++) {
+        const auto &it = iterators[i];
+        if (i != 0) {
+            stream << " && ";
+        }
+        stream << "(";
+        print_iterator(stream, it);
+        stream << " + " << op->width << " <= ";
+        print_iterator_bound(stream, it, true, partitioned);
+        stream << ") && (";
+        print_crd(it, op->width - 1);
+        stream << " - ";
+        print_crd(it, 0);
+        stream << " == " << (op->width - 1) << ")";
+        if (i != 0) {
+            stream << " && (";
+            print_crd(it, 0);
+            stream << " == ";
+            print_crd(first, 0);
+            stream << ")";
+        }
+    }
+    stream << ") {\n";
+    indent += 2;
+
+    print_indent();
+    stream << "const uint64_t ";
+    print_logical_index(stream);
+    stream << "_run = ";
+    print_crd(first, 0);
+    stream << ";\n";
+    for (const auto &it : iterators) {
+        print_indent();
+        stream << "const uint64_t ";
+        print_iterator(stream, it);
+        stream << "_run = ";
+        print_iterator(stream, it);
+        stream << ";\n";
+    }
+
+    print_indent();
+    stream << "for (uint64_t ";
+    print_logical_index(stream);
+    stream << "_offset = 0; ";
+    print_logical_index(stream);
+    stream << "_offset < " << op->width << "; ";
+    print_logical_index(stream);
+    stream << "_offset++) {\n";
+    indent += 2;
+
+    // Shadow the logical index and iterators, so the body prints unchanged.
+    print_indent();
+    stream << "const uint64_t ";
+    print_logical_index(stream);
+    stream << " = ";
+    print_logical_index(stream);
+    stream << "_run + ";
+    print_logical_index(stream);
+    stream << "_offset;\n";
+    for (const auto &it : iterators) {
+        print_indent();
+        stream << "const uint64_t ";
+        print_iterator(stream, it);
+        stream << " = ";
+        print_iterator(stream, it);
+        stream << "_run + ";
+        print_logical_index(stream);
+        stream << "_offset;\n";
+    }
+    print(op->body);
+
+    indent -= 2;
+    print_indent();
+    stream << "}\n";
+
+    for (const auto &it : iterators) {
+        print_indent();
+        print_iterator(stream, it);
+        stream << " += " << op->width << ";\n";
+    }
+    print_indent();
+    stream << "continue;\n";
+
+    indent -= 2;
+    print_indent();
+    stream << "}\n";
+}
+
+void IRPrinter::visit(const LIR::InterleavedLoopStmt *op) {
+    const LIR::ArrayLevel &it = op->iterator;
+    auto print_streams = [&](const std::string &suffix) {
+        print_iterator(stream, it);
+        stream << "_stream" << suffix;
+    };
+
+    print_indent();
+    stream << "{\n";
+    indent += 2;
+
+    print_indent();
+    stream << "uint64_t ";
+    print_streams("s");
+    stream << "[" << op->streams << "];\n";
+    print_indent();
+    stream << "uint64_t ";
+    print_streams("_ends");
+    stream << "[" << op->streams << "];\n";
+    print_indent();
+    stream << "const uint64_t ";
+    print_streams("_length");
+    stream << " = (";
+    print_iterator_bound(stream, it, true, partitioned);
+    stream << " - ";
+    print_iterator(stream, it);
+    stream << " + " << (op->streams - 1) << ") / " << op->streams << ";\n";
+
+    print_indent();
+    stream << "for (uint64_t ";
+    print_logical_index(stream);
+    stream << "_stream = 0; ";
+    print_logical_index(stream);
+    stream << "_stream < " << op->streams << "; ";
+    print_logical_index(stream);
+    stream << "_stream++) {\n";
+    indent += 2;
+    print_indent();
+    print_streams("s[");
+    print_logical_index(stream);
+    stream << "_stream] = min(";
+    print_iterator(stream, it);
+    stream << " + ";
+    print_logical_index(stream);
+    stream << "_stream * ";
+    print_streams("_length");
+    stream << ", ";
+    print_iterator_bound(stream, it, true, partitioned);
+    stream << ");\n";
+    print_indent();
+    print_streams("_ends[");
+    print_logical_index(stream);
+    stream << "_stream] = min(";
+    print_streams("s[");
+    print_logical_index(stream);
+    stream << "_stream] + ";
+    print_streams("_length");
+    stream << ", ";
+    print_iterator_bound(stream, it, true, partitioned);
+    stream << ");\n";
+    indent -= 2;
+    print_indent();
+    stream << "}\n";
+
+    print_indent();
+    stream << "for (bool ";
+    print_logical_index(stream);
+    stream << "_active = true; ";
+    print_logical_index(stream);
+    stream << "_active;) {\n";
+    indent += 2;
+    print_indent();
+    print_logical_index(stream);
+    stream << "_active = false;\n";
+    print_indent();
+    stream << "for (uint64_t ";
+    print_logical_index(stream);
+    stream << "_stream = 0; ";
+    print_logical_index(stream);
+    stream << "_stream < " << op->streams << "; ";
+    print_logical_index(stream);
+    stream << "_stream++) {\n";
+    indent += 2;
+
+    // Shadow the iterator with the stream's position, so the body prints unchanged.
+    print_indent();
+    stream << "const uint64_t ";
+    print_iterator(stream, it);
+    stream << " = ";
+    print_streams("s[");
+    print_logical_index(stream);
+    stream << "_stream];\n";
+    print_indent();
+    stream << "if (";
+    print_iterator(stream, it);
+    stream << " < ";
+    print_streams("_ends[");
+    print_logical_index(stream);
+    stream << "_stream]) {\n";
+    indent += 2;
+    print_indent();
+    print_logical_index(stream);
+    stream << "_active = true;\n";
+
+    print_indent();
+    stream << "if (";
+    print_iterator(stream, it);
+    stream << " + " << op->distance << " < ";
+    print_streams("_ends[");
+    print_logical_index(stream);
+    stream << "_stream]) {\n";
+    indent += 2;
+    for (const auto &array : op->gathered.iterators) {
+        print_indent();
+        stream << "__builtin_prefetch(&" << array.name << ".values[" << it.name << ".crd[";
+        print_iterator(stream, it);
+        stream << " + " << op->distance << "]]);\n";
+    }
+    indent -= 2;
+    print_indent();
+    stream << "}\n";
+
+    print(op->body);
+
+    print_indent();
+    print_streams("s[");
+    print_logical_index(stream);
+    stream << "_stream]++;\n";
+    indent -= 2;
+    print_indent();
+    stream << "}\n";
+
+    indent -= 2;
+    print_indent();
+    stream << "}\n";
+    indent -= 2;
+    print_indent();
+    stream << "}\n";
+
+    print_indent();
+    print_iterator(stream, it);
+    stream << " = ";
+    print_iterator_bound(stream, it, true, partitioned);
+    stream << ";\n";
+
+    indent -= 2;
+    print_indent();
+    stream << "}\n";
+}
+
+void IRPrinter::print_located_bounds(const LIR::ArrayLevel &extent, const LIR::IteratorSet &compressed) {
+    for (const auto &it : compressed.iterators) {
+        for (const bool upper : {false, true}) {
+            print_indent();
+            stream << "const uint64_t ";
+            print_iterator_bound(stream, it, upper, true);
+            stream << " = locate(" << it.name << ", ";
+            print_iterator_bound(stream, extent, upper, true);
+            stream << ");\n";
+        }
+    }
+}
+
+void IRPrinter::visit(const LIR::PartitionedForStmt *op) {
+    print_indent();
+    stream << "{\n";
+    indent += 2;
+
+    // Partitions of one per thread, of grain coordinates, or of grain nonzeros.
+    const bool per_thread = op->grain == 0;
+    const bool by_nonzeros = op->partitioning == LIR::Partitioning::Nonzeros;
+    // Nested in a shard (see ShardStmt), partitions are clamped to its range.
+    const bool clamped = partitioned;
+    if (clamped) {
+        for (const bool upper : {false, true}) {
+            print_indent();
+            stream << "const uint64_t ";
+            print_logical_index(stream);
+            stream << (upper ? "_shard_end = " : "_shard_begin = ");
+            print_iterator_bound(stream, op->extent, upper, true);
+            stream << ";\n";
+        }
+    }
+    if (per_thread) {
+        print_indent();
+        stream << "thread_pool &pool = kernel_thread_pool();\n";
+        print_indent();
+        stream << "const uint64_t parts = pool.size();\n";
+    } else if (by_nonzeros) {
+        print_indent();
+        if (!op->position_operand.empty()) {
+            stream << "const array *position_operand = &" << op->position_operand << ";\n";
+        } else {
+            stream << "const array *position_operand = nullptr;\n";
+            for (const auto &it : op->compressed.iterators) {
+                print_indent();
+                stream << "if (!position_operand || " << it.name << ".pos[1] - " << it.name
+                       << ".pos[0] > position_operand->pos[1] - position_operand->pos[0]) position_operand = &" << it.name << ";\n";
+            }
+        }
+        print_indent();
+        stream << "const uint64_t parts = balanced_chunk_count(position_operand, ";
+        print_iterator_bound(stream, op->extent, true, false);
+        stream << ", " << op->grain << ");\n";
+    } else {
+        print_indent();
+        stream << "const uint64_t parts = block_count(";
+        print_iterator_bound(stream, op->extent, true, false);
+        stream << ", " << op->grain << ");\n";
+    }
+
+    print_indent();
+    if (!op->parallel) {
+        stream << "for (uint64_t part = 0; part < parts; part++) {\n";
+    } else if (per_thread) {
+        stream << "pool.parallel_for_each_thread([&](const uint64_t part) {\n";
+    } else {
+        stream << "run_balanced(parts, [&](const uint64_t part) {\n";
+    }
+    indent += 2;
+
+    for (const bool upper : {false, true}) {
+        print_indent();
+        stream << "const uint64_t ";
+        print_iterator_bound(stream, op->extent, upper, true);
+        stream << " = " << (clamped ? "clamp_bound(" : "");
+        if (per_thread) {
+            stream << "partition_bound(";
+        } else if (by_nonzeros) {
+            stream << "balanced_chunk_bound(position_operand, ";
+        } else {
+            stream << "block_bound(";
+        }
+        print_iterator_bound(stream, op->extent, true, false);
+        if (per_thread || by_nonzeros) {
+            stream << (upper ? ", part + 1, parts)" : ", part, parts)");
+        } else {
+            stream << (upper ? ", part + 1, " : ", part, ") << op->grain << ")";
+        }
+        if (clamped) {
+            stream << ", ";
+            print_logical_index(stream);
+            stream << "_shard_begin, ";
+            print_logical_index(stream);
+            stream << "_shard_end)";
+        }
+        stream << ";\n";
+    }
+    print_located_bounds(op->extent, op->compressed);
+
+    const bool was_partitioned = partitioned;
+    partitioned = true;
+    print(op->body);
+    partitioned = was_partitioned;
+
+    indent -= 2;
+    print_indent();
+    stream << (op->parallel ? "});\n" : "}\n");
+
+    indent -= 2;
+    print_indent();
+    stream << "}\n";
+}
+
+void IRPrinter::visit(const LIR::ShardStmt *op) {
+    print_located_bounds(op->extent, op->compressed);
+
+    const bool was_partitioned = partitioned;
+    partitioned = true;
+    print(op->body);
+    partitioned = was_partitioned;
 }
 
 void IRPrinter::visit(const LIR::IncrementIterator *op) {
@@ -335,6 +1122,12 @@ void IRPrinter::visit(const LIR::IncrementIterator *op) {
     stream << "\n";
 }
 
+void IRPrinter::visit(const LIR::IncrementCounter *op) {
+    print_indent();
+    // Relaxed, as threads of a parallel kernel share the counters.
+    stream << "__atomic_fetch_add(&branch_counters[" << op->index << "], 1, __ATOMIC_RELAXED);\n";
+}
+
 void IRPrinter::visit(const LIR::CompressedIndexDefinition *op) {
     assert(op->array.format == Format::Compressed);
     print_indent();
@@ -377,15 +1170,15 @@ void IRPrinter::visit(const LIR::IteratorDefinition *op) {
         stream << "uint64_t ";
         print_iterator(stream, i);
         stream << " = ";
-        print_iterator_bound(stream, i, false);
+        print_iterator_bound(stream, i, false, partitioned);
         stream << ";\n";
     }
 }
 
 void IRPrinter::visit(const LIR::ArrayAssignment *op) {
     print_indent();
-    print_array_access(stream, op->array);
-    stream << " = ";
+    print_array_access(stream, op->array, hoisted.count(op->array.name) != 0);
+    stream << (op->accumulate ? " += " : " = ");
     print(op->value);
     stream << ";\n";
     // and increment iterator of written-to array.
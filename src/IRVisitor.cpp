@@ -37,9 +37,35 @@ void IRVisitor::visit(const ArrayAssignment *node) {
     node->rhs.accept(this);
 }
 
+void IRVisitor::visit(const Multi *node) {
+    for (const auto &stmt : node->stmts) {
+        stmt.accept(this);
+    }
+}
+
 void IRVisitor::visit(const LIR::ArrayAccess *node) {
 }
 
+void IRVisitor::visit(const LIR::Literal *node) {
+}
+
+void IRVisitor::visit(const LIR::Var *node) {
+}
+
+void IRVisitor::visit(const LIR::Select *node) {
+    node->cond.accept(this);
+    node->a.accept(this);
+    node->b.accept(this);
+}
+
+void IRVisitor::visit(const LIR::And *node) {
+    visit_binop(node);
+}
+
+void IRVisitor::visit(const LIR::Or *node) {
+    visit_binop(node);
+}
+
 void IRVisitor::visit(const LIR::Add *node) {
     visit_binop(node);
 }
@@ -54,11 +80,19 @@ void IRVisitor::visit(const LIR::SequenceStmt *node) {
     }
 }
 
+void IRVisitor::visit(const LIR::BlockStmt *node) {
+    node->body.accept(this);
+}
+
 void IRVisitor::visit(const LIR::WhileStmt *node) {
     // node->condition.accept(this);
     node->body.accept(this);
 }
 
+void IRVisitor::visit(const LIR::ForStmt *node) {
+    node->body.accept(this);
+}
+
 void IRVisitor::visit(const LIR::IfStmt *node) {
     for (size_t i = 0; i < node->conditions.size(); i++) {
         // node->conditions[i].accept(this);
@@ -66,9 +100,54 @@ void IRVisitor::visit(const LIR::IfStmt *node) {
     }
 }
 
+void IRVisitor::visit(const LIR::SwitchStmt *node) {
+    for (size_t i = 0; i < node->bodies.size(); i++) {
+        node->bodies[i].accept(this);
+    }
+}
+
+void IRVisitor::visit(const LIR::VarDefinition *node) {
+    node->value.accept(this);
+}
+
+void IRVisitor::visit(const LIR::KWayMergeStmt *node) {
+    node->definitions.accept(this);
+    node->guard.accept(this);
+    node->body.accept(this);
+}
+
+void IRVisitor::visit(const LIR::GallopStmt *node) {
+    node->body.accept(this);
+}
+
+void IRVisitor::visit(const LIR::DenseLocateStmt *node) {
+    node->definitions.accept(this);
+    node->guard.accept(this);
+    node->body.accept(this);
+}
+
+void IRVisitor::visit(const LIR::DenseRunStmt *node) {
+    node->body.accept(this);
+}
+
+void IRVisitor::visit(const LIR::InterleavedLoopStmt *node) {
+    node->body.accept(this);
+}
+
+void IRVisitor::visit(const LIR::PartitionedForStmt *node) {
+    node->body.accept(this);
+}
+
+void IRVisitor::visit(const LIR::ShardStmt *node) {
+    node->body.accept(this);
+}
+
 void IRVisitor::visit(const LIR::IncrementIterator *node) {
 }
 
+void IRVisitor::visit(const LIR::IncrementCounter *node) {
+}
+
 void IRVisitor::visit(const LIR::CompressedIndexDefinition *node) {
 }
 
@@ -1,16 +1,117 @@
 #include "IndexStmt.h"
+
+#include <cassert>
+
+#include "Arena.h"
 #include "IRVisitor.h"
 
 void IndexStmt::accept(IRVisitor *v) const {
     ptr->accept(v);
 }
 
+namespace {
+
+// The ForAll a transformation applies to.
+std::shared_ptr<const ForAll> get_forall(const IndexStmt &stmt) {
+    auto forall = stmt.as<ForAll>();
+    assert(forall != nullptr);
+    return forall;
+}
+
+// Name of the index variable the ForAll iterates over.
+std::string get_loop_index(const ForAll &forall) {
+    IndexStmt body = forall.body;
+    if (auto multi = body.as<Multi>()) {
+        body = multi->stmts.front();
+    }
+    auto assign_stmt = body.as<ArrayAssignment>();
+    assert(assign_stmt != nullptr);
+    return assign_stmt->lhs.indices[0].name;
+}
+
+// Whether i names the loop the body runs in: the inner loop of a split, or
+// the whole loop otherwise.
+bool is_innermost(const ForAll &forall, const Index &i) {
+    return i.name == (forall.schedule.split_factor != 0 ? forall.schedule.inner : get_loop_index(forall));
+}
+
+}  // namespace
+
+IndexStmt IndexStmt::split(const Index &i, const Index &i0, const Index &i1, const uint64_t factor) const {
+    auto forall = get_forall(*this);
+    assert(i.name == get_loop_index(*forall));
+    assert(forall->schedule.split_factor == 0);
+    assert(factor > 0);
+    assert(i0.name != i1.name);
+
+    Schedule schedule = forall->schedule;
+    schedule.outer = i0.name;
+    schedule.inner = i1.name;
+    schedule.split_factor = factor;
+    return ForAll::make(forall->sexpr, forall->body, schedule);
+}
+
+IndexStmt IndexStmt::split_pos(const Index &i, const Access &operand, const Index &i0, const Index &i1, const uint64_t factor) const {
+    IndexStmt stmt = split(i, i0, i1, factor);
+    auto forall = get_forall(stmt);
+    assert(operand.indices.size() == 1 && operand.indices[0].name == i.name);
+
+    Schedule schedule = forall->schedule;
+    schedule.position_operand = operand.name;
+    return ForAll::make(forall->sexpr, forall->body, schedule);
+}
+
+IndexStmt IndexStmt::parallelize(const Index &i) const {
+    auto forall = get_forall(*this);
+    // Only the outermost loop can run in parallel: every block of a split
+    // writes a disjoint range of the output, the coordinates within one don't.
+    assert(i.name == (forall->schedule.split_factor != 0 ? forall->schedule.outer : get_loop_index(*forall)));
+
+    Schedule schedule = forall->schedule;
+    schedule.parallel = i.name;
+    return ForAll::make(forall->sexpr, forall->body, schedule);
+}
+
+IndexStmt IndexStmt::vectorize(const Index &i, const uint64_t width) const {
+    auto forall = get_forall(*this);
+    assert(is_innermost(*forall, i));
+    assert(width > 1);
+
+    Schedule schedule = forall->schedule;
+    schedule.vectorize_width = width;
+    return ForAll::make(forall->sexpr, forall->body, schedule);
+}
+
+IndexStmt IndexStmt::unroll(const Index &i, const uint64_t factor) const {
+    auto forall = get_forall(*this);
+    assert(is_innermost(*forall, i));
+    assert(factor > 1);
+
+    Schedule schedule = forall->schedule;
+    schedule.unroll_count = factor;
+    return ForAll::make(forall->sexpr, forall->body, schedule);
+}
+
+IndexStmt IndexStmt::interleave(const Index &i, const uint64_t streams) const {
+    auto forall = get_forall(*this);
+    assert(is_innermost(*forall, i));
+    assert(streams > 1);
+
+    Schedule schedule = forall->schedule;
+    schedule.interleave_streams = streams;
+    return ForAll::make(forall->sexpr, forall->body, schedule);
+}
+
 void ForAll::accept(IRVisitor *v) const {
     v->visit(this);
 }
 
 const std::shared_ptr<const ForAll> ForAll::make(SetExpr _sexpr, IndexStmt _body) {
-    return std::make_shared<ForAll>(_sexpr, _body);
+    return make_tagged_node<ForAll>(_sexpr, _body);
+}
+
+const std::shared_ptr<const ForAll> ForAll::make(SetExpr _sexpr, IndexStmt _body, const Schedule &_schedule) {
+    return make_tagged_node<ForAll>(_sexpr, _body, _schedule);
 }
 
 void ArrayAssignment::accept(IRVisitor *v) const {
@@ -18,5 +119,13 @@ void ArrayAssignment::accept(IRVisitor *v) const {
 }
 
 const std::shared_ptr<const ArrayAssignment> ArrayAssignment::make(const Access &_lhs, Expr _rhs) {
-    return std::make_shared<ArrayAssignment>(_lhs, _rhs);
+    return make_tagged_node<ArrayAssignment>(_lhs, _rhs);
+}
+
+void Multi::accept(IRVisitor *v) const {
+    v->visit(this);
+}
+
+const std::shared_ptr<const Multi> Multi::make(const std::vector<IndexStmt> &_stmts) {
+    return make_tagged_node<Multi>(_stmts);
 }
@@ -1,20 +1,25 @@
 #include "JIT.h"
 
+#include "Arena.h"
+#include "Canonicalize.h"
 #include "GatherIteratorSet.h"
 #include "IndexStmt.h"
 #include "IRPrinter.h"
+#include "IRVisitor.h"
 #include "LIR.h"
 #include "Lower.h"
+#include "TaskGraph.h"
 
 #include <algorithm>
+#include <cassert>
 #include <cstdio>
 #include <iostream>
 #include <fstream>
+#include <map>
+#include <set>
 #include <vector>
 #include <string>
 
-namespace {
-
 // Gathers iterators in in-order traversal.
 std::vector<std::string> get_arg_list(const IndexStmt &stmt, const FormatMap &formats) {
     LIR::IteratorSet iset = gather_iterator_set(stmt, formats);
@@ -24,9 +29,290 @@ std::vector<std::string> get_arg_list(const IndexStmt &stmt, const FormatMap &fo
     return arg_list;
 }
 
+std::string make_temporary_file() {
+    char name_template[] = "/tmp/cs343_test.XXXXXX";
+    // Requires POSIX.
+    mkstemp(name_template);
+    return name_template;
+}
+
+namespace {
+
+// Formats of the arrays a lowered statement reads and writes, whether it
+// runs on the thread pool, and the runtime headers it needs.
+struct KernelInfo : public IRVisitor {
+    std::map<std::string, Format> formats;
+    // Arrays the kernel writes, in order of first write.
+    std::vector<std::string> outputs;
+    bool parallel = false;
+    // Headers of include/runtime, e.g. "merge" for runtime/merge.h.
+    std::set<std::string> headers;
+
+    void visit(const LIR::ArrayAccess *node) override {
+        formats[node->array.name] = node->array.format;
+    }
+
+    void visit(const LIR::ArrayAssignment *node) override {
+        formats[node->array.name] = node->array.format;
+        if (std::find(outputs.cbegin(), outputs.cend(), node->array.name) == outputs.cend()) {
+            outputs.push_back(node->array.name);
+        }
+        IRVisitor::visit(node);
+    }
+
+    bool dense_outputs() const {
+        return std::all_of(outputs.cbegin(), outputs.cend(),
+                           [&](const std::string &output) { return formats.at(output) == Format::Dense; });
+    }
+
+    std::vector<LIR::ArrayLevel> compressed(const std::vector<std::string> &arg_list) const {
+        std::vector<LIR::ArrayLevel> levels;
+        for (const auto &arg : arg_list) {
+            if (formats.at(arg) == Format::Compressed) {
+                levels.push_back(LIR::ArrayLevel{arg, Format::Compressed});
+            }
+        }
+        return levels;
+    }
+
+    void visit(const LIR::KWayMergeStmt *node) override {
+        headers.insert("merge");
+        IRVisitor::visit(node);
+    }
+
+    void visit(const LIR::GallopStmt *node) override {
+        headers.insert("merge");
+        IRVisitor::visit(node);
+    }
+
+    void visit(const LIR::PartitionedForStmt *node) override {
+        parallel |= node->parallel;
+        headers.insert("parallel");
+        // Partitions by nonzeros, and balanced runs of them.
+        if (node->partitioning == LIR::Partitioning::Nonzeros || (node->parallel && node->grain != 0)) {
+            headers.insert("scheduler");
+        }
+        IRVisitor::visit(node);
+    }
+};
+
+// Entry points emitted besides kernel(array &...).
+enum class EntryPoints {
+    Kernel,
+    // kernel_batch.
+    Batched,
+    // kernel_shard and kernel_sharded.
+    Sharded,
+};
+
+// Emit the rest of an entry point's signature, after its leading parameters.
+void emit_signature(std::ostream &file, const std::vector<std::string> &arg_list) {
+    for (const auto &arg : arg_list) {
+        file << ", array &" << arg;
+    }
+    file << ") {\n";
+}
+
+// Emit kernel_batch, which runs kernel over each of K stacked vectors (see
+// runtime/batch.h) in parallel across vectors.
+void emit_kernel_batch(std::ostream &file, const KernelInfo &info, const std::vector<std::string> &arg_list) {
+    file << "void kernel_batch(const uint64_t K";
+    emit_signature(file, arg_list);
+    file << "  run_batch(K, [&](const uint64_t k) {\n";
+    for (const auto &arg : arg_list) {
+        const Format format = info.formats.at(arg);
+        file << "    array " << arg << "_segment = batch_segment_"
+             << (format == Format::Compressed ? "compressed" : "dense") << "(" << arg << ", k);\n";
+    }
+    file << "    kernel(";
+    for (size_t i = 0; i < arg_list.size(); i++) {
+        file << (i != 0 ? ", " : "") << arg_list[i] << "_segment";
+    }
+    file << ");\n";
+    file << "  });\n";
+    file << "}\n\n";
+}
+
+// Emit kernel_shard, which runs stmt on the coordinates [i_part_begin,
+// i_part_end) only, and kernel_sharded, which runs it over P shards in
+// worker processes (see runtime/shard.h) and returns the number of shards
+// that failed. The outputs must be dense, the first one being arg_list[0].
+void emit_kernel_sharded(std::ostream &file, const LIR::Stmt &stmt, const KernelInfo &info, const std::vector<std::string> &arg_list) {
+    const LIR::ArrayLevel out{arg_list[0], Format::Dense};
+    const std::vector<LIR::ArrayLevel> compressed = info.compressed(arg_list);
+
+    file << "void kernel_shard(const uint64_t i_part_begin, const uint64_t i_part_end";
+    emit_signature(file, arg_list);
+    file << LIR::Stmt(LIR::ShardStmt::make(out, LIR::IteratorSet{compressed}, stmt)) << "\n";
+    file << "}\n\n";
+
+    file << "uint64_t kernel_sharded(const uint64_t P";
+    emit_signature(file, arg_list);
+    file << "  const array *largest = " << (compressed.empty() ? "nullptr" : "largest_compressed({");
+    for (size_t i = 0; i < compressed.size(); i++) {
+        file << (i != 0 ? ", " : "") << "&" << compressed[i].name;
+    }
+    file << (compressed.empty() ? ";\n" : "});\n");
+    file << "  shard_set shared(\"kernel\");\n";
+    for (const auto &arg : arg_list) {
+        file << "  if (!shared.share(" << arg << ", " << (info.formats.at(arg) == Format::Compressed ? "true" : "false")
+             << ")) {\n";
+        file << "    return P;\n";
+        file << "  }\n";
+    }
+    file << "  const uint64_t failed = run_sharded(shard_bounds(largest, " << out.name
+         << ".shape[0], P), [&](const uint64_t begin, const uint64_t end) {\n";
+    file << "    std::vector<array> arrays = shared.attach();\n";
+    file << "    if (arrays.size() != shared.size()) {\n";
+    file << "      _exit(1);\n";
+    file << "    }\n";
+    file << "    kernel_shard(begin, end";
+    for (size_t i = 0; i < arg_list.size(); i++) {
+        file << ", arrays[" << i << "]";
+    }
+    file << ");\n";
+    file << "  });\n";
+    for (const auto &output : info.outputs) {
+        const size_t index = std::find(arg_list.cbegin(), arg_list.cend(), output) - arg_list.cbegin();
+        file << "  shared.copy_back(" << index << ", " << output << ");\n";
+    }
+    file << "  return failed;\n";
+    file << "}\n\n";
+}
+
+// Emit the includes of runtime/array.h and of the other runtime headers the
+// file uses, so kernels that don't shard or run in parallel don't pull in
+// their platform dependencies.
+void emit_includes(std::ostream &file, const std::set<std::string> &headers) {
+    file << "#include \"runtime/array.h\"\n";
+    for (const auto &header : headers) {
+        file << "#include \"runtime/" << header << ".h\"\n";
+    }
+    file << "\n#include <cassert>\n\n";
+}
+
+void emit_kernel(std::ostream &file, const std::string &name, const LIR::Stmt &stmt, const std::vector<std::string> &arg_list) {
+    file << "void " << name << "(";
+
+    const size_t n = arg_list.size();
+    for (size_t i = 0; i < n; i++) {
+        if (i != 0) {
+            file << ", ";
+        }
+        file << "array &" << arg_list[i];
+    }
+    file << ") {\n";
+
+    file << stmt << "\n";
+
+    file << "}\n\n";
+}
+
+// Name of the entry point of a variant of a versioned kernel.
+std::string variant_kernel_name(const KernelVariant &variant) {
+    switch (variant.kind) {
+    case KernelVariantKind::Merge:
+        return "kernel_merge";
+    case KernelVariantKind::DenseLocate:
+        return "kernel_dense_locate";
+    case KernelVariantKind::Gallop:
+        return "kernel_gallop_" + variant.lead;
+    }
+    return "kernel";
+}
+
+// Emit kernel, the prologue of a versioned kernel: it estimates the cost of
+// each variant from the nonzeros of the compressed operands and the extent of
+// the output (see runtime/versioning.h), and runs the cheapest. Variants
+// besides the first require a dense output, arg_list[0], and compressed
+// operands only.
+void emit_kernel_prologue(std::ostream &file, const std::vector<KernelVariant> &variants, const std::vector<std::string> &arg_list) {
+    const size_t K = arg_list.size() - 1;
+    file << "void kernel(";
+    for (size_t i = 0; i < arg_list.size(); i++) {
+        file << (i != 0 ? ", " : "") << "array &" << arg_list[i];
+    }
+    file << ") {\n";
+    file << "  const uint64_t nnz[" << K << "] = {";
+    for (size_t k = 0; k < K; k++) {
+        file << (k != 0 ? ", " : "") << arg_list[k + 1] << ".pos[1] - " << arg_list[k + 1] << ".pos[0]";
+    }
+    file << "};\n";
+    file << "  const double costs[" << variants.size() << "] = {\n";
+    for (const auto &variant : variants) {
+        file << "    ";
+        switch (variant.kind) {
+        case KernelVariantKind::Merge:
+            file << "merge_variant_cost(nnz, " << K << ")";
+            break;
+        case KernelVariantKind::DenseLocate:
+            file << "dense_locate_variant_cost(" << arg_list[0] << ".shape[0], " << K << ")";
+            break;
+        case KernelVariantKind::Gallop: {
+            const size_t lead = std::find(arg_list.cbegin() + 1, arg_list.cend(), variant.lead) - (arg_list.cbegin() + 1);
+            file << "gallop_variant_cost(nnz, " << K << ", " << lead << ")";
+            break;
+        }
+        }
+        file << ",\n";
+    }
+    file << "  };\n";
+    file << "  switch (cheapest_variant(costs, " << variants.size() << ")) {\n";
+    for (size_t v = 0; v < variants.size(); v++) {
+        file << "  case " << v << ":\n";
+        file << "    " << variant_kernel_name(variants[v]) << "(";
+        for (size_t i = 0; i < arg_list.size(); i++) {
+            file << (i != 0 ? ", " : "") << arg_list[i];
+        }
+        file << ");\n";
+        file << "    return;\n";
+    }
+    file << "  }\n";
+    file << "}\n\n";
+}
+
+// Runs the test in test_file against the kernels in filename.
+void run_test(const std::string &filename, const std::string &test_file) {
+    const std::string command = "./run_test.sh " + filename + " " + test_file;
+    std::cout << "Running test " << test_file << std::endl;
+    system(command.c_str());
+}
+
+// Write kernel(array &...) computing stmt, and entry_points besides, to
+// filename.
+void emit_kernel_file(const LIR::Stmt &stmt, const std::vector<std::string> &arg_list, const std::string &filename,
+                      const EntryPoints entry_points) {
+    KernelInfo info;
+    stmt.accept(&info);
+    // Parallel kernels already use the pool, which can't be re-entered, and
+    // shards write disjoint ranges of dense outputs.
+    assert(entry_points == EntryPoints::Kernel || !info.parallel);
+    assert(entry_points != EntryPoints::Sharded || info.dense_outputs());
+    if (entry_points == EntryPoints::Batched) {
+        info.headers.insert("batch");
+    } else if (entry_points == EntryPoints::Sharded) {
+        info.headers.insert("shard");
+    }
+
+    std::ofstream file;
+    file.open(filename);
+
+    emit_includes(file, info.headers);
+    emit_kernel(file, "kernel", stmt, arg_list);
+    if (entry_points == EntryPoints::Batched) {
+        emit_kernel_batch(file, info, arg_list);
+    } else if (entry_points == EntryPoints::Sharded) {
+        emit_kernel_sharded(file, stmt, info, arg_list);
+    }
+
+    file.close();
+}
+
 }  // namespace
 
 void compile(const Assignment &assignment, const FormatMap &formats, const std::string &filename) {
+    // Allocate the IR of this compilation together (see Arena.h).
+    IRArena arena;
     IndexStmt stmt = lower(assignment);
     LIR::Stmt lstmt = lower(stmt, formats);
     std::vector<std::string> arg_list = get_arg_list(stmt, formats);
@@ -35,45 +321,260 @@ void compile(const Assignment &assignment, const FormatMap &formats, const std::
 
 // Compiles into a temporary file and runs the corresponding test.
 void compile_and_test(const Assignment &assignment, const FormatMap &formats, const std::string &test_file) {
+    IRArena arena;
     IndexStmt stmt = lower(assignment);
     LIR::Stmt lstmt = lower(stmt, formats);
     std::vector<std::string> arg_list = get_arg_list(stmt, formats);
     compile_and_test(lstmt, arg_list, test_file);
 }
 
-void compile_to_file(const LIR::Stmt &stmt, const std::vector<std::string> &arg_list, const std::string &filename) {
+void compile_batched(const Assignment &assignment, const FormatMap &formats, const std::string &filename) {
+    IRArena arena;
+    IndexStmt stmt = lower(assignment);
+    compile_batched_to_file(lower(stmt, formats), get_arg_list(stmt, formats), filename);
+}
+
+void compile_batched_and_test(const Assignment &assignment, const FormatMap &formats, const std::string &test_file) {
+    const std::string filename = make_temporary_file();
+    compile_batched(assignment, formats, filename);
+    run_test(filename, test_file);
+}
+
+void compile_sharded(const Assignment &assignment, const FormatMap &formats, const std::string &filename) {
+    IRArena arena;
+    IndexStmt stmt = lower(assignment);
+    compile_sharded_to_file(lower(stmt, formats), get_arg_list(stmt, formats), filename);
+}
+
+void compile_sharded_and_test(const Assignment &assignment, const FormatMap &formats, const std::string &test_file) {
+    const std::string filename = make_temporary_file();
+    compile_sharded(assignment, formats, filename);
+    run_test(filename, test_file);
+}
+
+void compile(const Assignment &assignment, const FormatMap &formats, const OperandStatsMap &stats, const std::string &filename) {
+    IRArena arena;
+    IndexStmt stmt = lower(assignment);
+    LIR::Stmt lstmt = lower(stmt, formats, stats);
+    compile_to_file(lstmt, get_arg_list(stmt, formats), filename);
+}
+
+void compile_and_test(const Assignment &assignment, const FormatMap &formats, const OperandStatsMap &stats, const std::string &test_file) {
+    const std::string filename = make_temporary_file();
+    compile(assignment, formats, stats, filename);
+    run_test(filename, test_file);
+}
+
+void compile_instrumented(const Assignment &assignment, const FormatMap &formats, const std::string &profile_file,
+                          const std::string &filename) {
+    IRArena arena;
+    IndexStmt stmt = lower(assignment);
+    std::vector<std::string> counter_keys;
+    LIR::Stmt lstmt = lower_instrumented(stmt, formats, counter_keys);
+
+    KernelInfo info;
+    lstmt.accept(&info);
+    info.headers.insert("profile");
+
     std::ofstream file;
     file.open(filename);
 
-    file << "#include \"runtime/array.h\"\n\n";
-    file << "#include <cassert>\n\n";
+    emit_includes(file, info.headers);
+    // Zero-length arrays are not standard, so there is always a counter.
+    const size_t counters = std::max<size_t>(counter_keys.size(), 1);
+    file << "uint64_t branch_counters[" << counters << "] = {};\n";
+    file << "const char *const branch_counter_keys[" << counters << "] = {";
+    for (size_t k = 0; k < counter_keys.size(); k++) {
+        file << (k != 0 ? ", " : "") << "\"" << counter_keys[k] << "\"";
+    }
+    file << "};\n";
+    file << "struct branch_profile_writer {\n";
+    file << "  ~branch_profile_writer() {\n";
+    file << "    append_branch_profile(\"" << profile_file << "\", branch_counter_keys, branch_counters, "
+         << counter_keys.size() << ");\n";
+    file << "  }\n";
+    file << "} branch_profile_writer_at_exit;\n\n";
+    emit_kernel(file, "kernel", lstmt, get_arg_list(stmt, formats));
 
-    file << "void kernel(";
+    file.close();
+}
 
-    const size_t n = arg_list.size();
-    for (size_t i = 0; i < n; i++) {
-        if (i != 0) {
-            file << ", ";
-        }
-        file << "array &" << arg_list[i];
+void compile_instrumented_and_test(const Assignment &assignment, const FormatMap &formats, const std::string &profile_file,
+                                   const std::string &test_file) {
+    const std::string filename = make_temporary_file();
+    compile_instrumented(assignment, formats, profile_file, filename);
+    run_test(filename, test_file);
+}
+
+void compile(const Assignment &assignment, const FormatMap &formats, const BranchProfile &profile, const std::string &filename) {
+    IRArena arena;
+    IndexStmt stmt = lower(assignment);
+    LIR::Stmt lstmt = lower(stmt, formats, profile);
+    compile_to_file(lstmt, get_arg_list(stmt, formats), filename);
+}
+
+void compile_and_test(const Assignment &assignment, const FormatMap &formats, const BranchProfile &profile, const std::string &test_file) {
+    const std::string filename = make_temporary_file();
+    compile(assignment, formats, profile, filename);
+    run_test(filename, test_file);
+}
+
+void compile_versioned(const Assignment &assignment, const FormatMap &formats, const std::string &filename) {
+    IRArena arena;
+    IndexStmt stmt = lower(assignment);
+    const std::vector<KernelVariant> variants = lower_variants(stmt, formats);
+    std::vector<std::string> arg_list = get_arg_list(stmt, formats);
+    if (variants.size() == 1) {
+        compile_to_file(variants.front().stmt, arg_list, filename);
+        return;
     }
-    file << ") {\n";
 
-    file << stmt << "\n";
+    KernelInfo info;
+    for (const auto &variant : variants) {
+        variant.stmt.accept(&info);
+    }
+    info.headers.insert("versioning");
 
-    file << "}\n\n";
+    std::ofstream file;
+    file.open(filename);
+
+    emit_includes(file, info.headers);
+    for (const auto &variant : variants) {
+        emit_kernel(file, variant_kernel_name(variant), variant.stmt, arg_list);
+    }
+    emit_kernel_prologue(file, variants, arg_list);
 
     file.close();
 }
 
+void compile_versioned_and_test(const Assignment &assignment, const FormatMap &formats, const std::string &test_file) {
+    const std::string filename = make_temporary_file();
+    compile_versioned(assignment, formats, filename);
+    run_test(filename, test_file);
+}
+
+const CachedKernel &compile_cached(KernelCache &cache, const Assignment &assignment, const FormatMap &formats) {
+    const std::string key = kernel_cache_key(assignment, formats);
+    auto cached = cache.kernels.find(key);
+    if (cached != cache.kernels.end()) {
+        return cached->second;
+    }
+
+    const Assignment canonical = canonicalize(assignment);
+    const CachedKernel kernel{make_temporary_file(), get_arg_list(lower(canonical), formats)};
+    compile(canonical, formats, kernel.filename);
+    return cache.kernels.emplace(key, kernel).first->second;
+}
+
+void compile(const std::vector<Assignment> &assignments, const FormatMap &formats, const std::string &filename) {
+    IRArena arena;
+    IndexStmt stmt = lower(assignments);
+    LIR::Stmt lstmt = lower(stmt, formats);
+    std::vector<std::string> arg_list = get_arg_list(stmt, formats);
+    compile_to_file(lstmt, arg_list, filename);
+}
+
+void compile_and_test(const std::vector<Assignment> &assignments, const FormatMap &formats, const std::string &test_file) {
+    IRArena arena;
+    IndexStmt stmt = lower(assignments);
+    LIR::Stmt lstmt = lower(stmt, formats);
+    std::vector<std::string> arg_list = get_arg_list(stmt, formats);
+    compile_and_test(lstmt, arg_list, test_file);
+}
+
+void compile_sharded(const std::vector<Assignment> &assignments, const FormatMap &formats, const std::string &filename) {
+    IRArena arena;
+    IndexStmt stmt = lower(assignments);
+    compile_sharded_to_file(lower(stmt, formats), get_arg_list(stmt, formats), filename);
+}
+
+void compile_sharded_and_test(const std::vector<Assignment> &assignments, const FormatMap &formats, const std::string &test_file) {
+    const std::string filename = make_temporary_file();
+    compile_sharded(assignments, formats, filename);
+    run_test(filename, test_file);
+}
+
+void compile_to_file(const LIR::Stmt &stmt, const std::vector<std::string> &arg_list, const std::string &filename) {
+    emit_kernel_file(stmt, arg_list, filename, EntryPoints::Kernel);
+}
+
+void compile_batched_to_file(const LIR::Stmt &stmt, const std::vector<std::string> &arg_list, const std::string &filename) {
+    emit_kernel_file(stmt, arg_list, filename, EntryPoints::Batched);
+}
+
+void compile_sharded_to_file(const LIR::Stmt &stmt, const std::vector<std::string> &arg_list, const std::string &filename) {
+    emit_kernel_file(stmt, arg_list, filename, EntryPoints::Sharded);
+}
+
 
 void compile_and_test(const LIR::Stmt &stmt, const std::vector<std::string> &arg_list, const std::string &test_file) {
-    char name_template[] = "/tmp/cs343_test.XXXXXX";
-    // Requires POSIX.
-    mkstemp(name_template);
-    const std::string filename = name_template;
+    const std::string filename = make_temporary_file();
     compile_to_file(stmt, arg_list, filename);
-    const std::string command = "./run_test.sh " + filename + " " + test_file;
-    std::cout << "Running test " << test_file << std::endl;
-    system(command.c_str());
+    run_test(filename, test_file);
+}
+
+void compile_sharded_and_test(const LIR::Stmt &stmt, const std::vector<std::string> &arg_list, const std::string &test_file) {
+    const std::string filename = make_temporary_file();
+    compile_sharded_to_file(stmt, arg_list, filename);
+    run_test(filename, test_file);
+}
+
+void compile_graph(const TaskGraph &graph, const FormatMap &formats, const std::string &filename) {
+    IRArena arena;
+    KernelInfo info;
+    std::vector<LIR::Stmt> kernels;
+    std::vector<std::vector<std::string>> kernel_args;
+    std::vector<std::string> graph_args;
+    for (size_t t = 0; t < graph.assignments.size(); t++) {
+        IndexStmt stmt = lower(graph.assignments[t]);
+        kernels.push_back(lower(stmt, formats));
+        kernels.back().accept(&info);
+        kernel_args.push_back(get_arg_list(stmt, formats));
+        for (const auto &arg : kernel_args.back()) {
+            if (std::find(graph_args.cbegin(), graph_args.cend(), arg) == graph_args.cend()) {
+                graph_args.push_back(arg);
+            }
+        }
+    }
+    info.headers.insert("graph");
+
+    std::ofstream file;
+    file.open(filename);
+
+    emit_includes(file, info.headers);
+    for (size_t t = 0; t < kernels.size(); t++) {
+        emit_kernel(file, "kernel_" + std::to_string(t), kernels[t], kernel_args[t]);
+    }
+
+    file << "void kernel_graph(";
+    for (size_t i = 0; i < graph_args.size(); i++) {
+        file << (i != 0 ? ", " : "") << "array &" << graph_args[i];
+    }
+    file << ") {\n";
+    file << "  run_task_graph({\n";
+    for (size_t t = 0; t < kernel_args.size(); t++) {
+        file << "    [&] { kernel_" << t << "(";
+        for (size_t i = 0; i < kernel_args[t].size(); i++) {
+            file << (i != 0 ? ", " : "") << kernel_args[t][i];
+        }
+        file << "); },\n";
+    }
+    file << "  }, {\n";
+    for (const auto &dependencies : graph.dependencies) {
+        file << "    {";
+        for (size_t i = 0; i < dependencies.size(); i++) {
+            file << (i != 0 ? ", " : "") << dependencies[i];
+        }
+        file << "},\n";
+    }
+    file << "  });\n";
+    file << "}\n\n";
+
+    file.close();
+}
+
+void compile_and_test(const TaskGraph &graph, const FormatMap &formats, const std::string &test_file) {
+    const std::string filename = make_temporary_file();
+    compile_graph(graph, formats, filename);
+    run_test(filename, test_file);
 }
@@ -1,4 +1,5 @@
 #include "LIR.h"
+#include "Arena.h"
 #include "IRVisitor.h"
 
 namespace LIR {
@@ -19,7 +20,47 @@ void ArrayAccess::accept(IRVisitor *v) const {
 }
 
 const std::shared_ptr<const ArrayAccess> ArrayAccess::make(const ArrayLevel &_array) {
-    return std::make_shared<ArrayAccess>(_array);
+    return make_tagged_node<ArrayAccess>(_array);
+}
+
+void Literal::accept(IRVisitor *v) const {
+    v->visit(this);
+}
+
+const std::shared_ptr<const Literal> Literal::make(const float _value) {
+    return make_tagged_node<Literal>(_value);
+}
+
+void Var::accept(IRVisitor *v) const {
+    v->visit(this);
+}
+
+const std::shared_ptr<const Var> Var::make(const std::string &_name) {
+    return make_tagged_node<Var>(_name);
+}
+
+void Select::accept(IRVisitor *v) const {
+    v->visit(this);
+}
+
+const std::shared_ptr<const Select> Select::make(const Expr &_cond, const Expr &_a, const Expr &_b) {
+    return make_tagged_node<Select>(_cond, _a, _b);
+}
+
+void And::accept(IRVisitor *v) const {
+    v->visit(this);
+}
+
+const std::shared_ptr<const And> And::make(const Expr &_a, const Expr &_b) {
+    return make_tagged_node<And>(_a, _b);
+}
+
+void Or::accept(IRVisitor *v) const {
+    v->visit(this);
+}
+
+const std::shared_ptr<const Or> Or::make(const Expr &_a, const Expr &_b) {
+    return make_tagged_node<Or>(_a, _b);
 }
 
 void Mul::accept(IRVisitor *v) const {
@@ -27,7 +68,7 @@ void Mul::accept(IRVisitor *v) const {
 }
 
 const std::shared_ptr<const Mul> Mul::make(const Expr &_a, const Expr &_b) {
-    return std::make_shared<Mul>(_a, _b);
+    return make_tagged_node<Mul>(_a, _b);
 }
 
 void Add::accept(IRVisitor *v) const {
@@ -35,7 +76,7 @@ void Add::accept(IRVisitor *v) const {
 }
 
 const std::shared_ptr<const Add> Add::make(const Expr &_a, const Expr &_b) {
-    return std::make_shared<Add>(_a, _b);
+    return make_tagged_node<Add>(_a, _b);
 }
 
 
@@ -48,7 +89,15 @@ void SequenceStmt::accept(IRVisitor *v) const {
 }
 
 const std::shared_ptr<const SequenceStmt> SequenceStmt::make(const std::vector<Stmt> _stmts) {
-    return std::make_shared<SequenceStmt>(_stmts);
+    return make_tagged_node<SequenceStmt>(_stmts);
+}
+
+void BlockStmt::accept(IRVisitor *v) const {
+    v->visit(this);
+}
+
+const std::shared_ptr<const BlockStmt> BlockStmt::make(const Stmt &_body) {
+    return make_tagged_node<BlockStmt>(_body);
 }
 
 void WhileStmt::accept(IRVisitor *v) const {
@@ -56,7 +105,23 @@ void WhileStmt::accept(IRVisitor *v) const {
 }
 
 const std::shared_ptr<const WhileStmt> WhileStmt::make(const IteratorSet &_condition, const Stmt &_body) {
-    return std::make_shared<WhileStmt>(_condition, _body);
+    return make_tagged_node<WhileStmt>(_condition, _body);
+}
+
+const std::shared_ptr<const WhileStmt> WhileStmt::make(const IteratorSet &_condition, const Stmt &_body, const LoopHints &_hints) {
+    return make_tagged_node<WhileStmt>(_condition, _body, _hints);
+}
+
+void ForStmt::accept(IRVisitor *v) const {
+    v->visit(this);
+}
+
+const std::shared_ptr<const ForStmt> ForStmt::make(const ArrayLevel &_bound, const IteratorSet &_arrays, const Stmt &_body) {
+    return make_tagged_node<ForStmt>(_bound, _arrays, _body);
+}
+
+const std::shared_ptr<const ForStmt> ForStmt::make(const ArrayLevel &_bound, const IteratorSet &_arrays, const Stmt &_body, const LoopHints &_hints) {
+    return make_tagged_node<ForStmt>(_bound, _arrays, _body, _hints);
 }
 
 void IfStmt::accept(IRVisitor *v) const {
@@ -64,7 +129,97 @@ void IfStmt::accept(IRVisitor *v) const {
 }
 
 const std::shared_ptr<const IfStmt> IfStmt::make(const std::vector<IteratorSet> &_conditions, const std::vector<Stmt> _bodies) {
-    return std::make_shared<IfStmt>(_conditions, _bodies);
+    return make_tagged_node<IfStmt>(_conditions, _bodies);
+}
+
+const std::shared_ptr<const IfStmt> IfStmt::make(const std::vector<IteratorSet> &_conditions, const std::vector<Stmt> _bodies,
+                                                 const std::vector<BranchHint> &_hints) {
+    return make_tagged_node<IfStmt>(_conditions, _bodies, _hints);
+}
+
+void SwitchStmt::accept(IRVisitor *v) const {
+    v->visit(this);
+}
+
+const std::shared_ptr<const SwitchStmt> SwitchStmt::make(const IteratorSet &_iterators, const std::vector<std::vector<uint64_t>> &_cases, const std::vector<Stmt> &_bodies) {
+    return make_tagged_node<SwitchStmt>(_iterators, _cases, _bodies);
+}
+
+void VarDefinition::accept(IRVisitor *v) const {
+    v->visit(this);
+}
+
+const std::shared_ptr<const VarDefinition> VarDefinition::make(const std::string &_name, const ScalarType _type, const Expr &_value) {
+    return make_tagged_node<VarDefinition>(_name, _type, _value);
+}
+
+void KWayMergeStmt::accept(IRVisitor *v) const {
+    v->visit(this);
+}
+
+const std::shared_ptr<const KWayMergeStmt> KWayMergeStmt::make(const IteratorSet &_iterators, const Stmt &_definitions, const Expr &_guard, const Stmt &_body) {
+    return make_tagged_node<KWayMergeStmt>(_iterators, _definitions, _guard, _body);
+}
+
+void GallopStmt::accept(IRVisitor *v) const {
+    v->visit(this);
+}
+
+const std::shared_ptr<const GallopStmt> GallopStmt::make(const ArrayLevel &_lead, const IteratorSet &_others, const Stmt &_body) {
+    return make_tagged_node<GallopStmt>(_lead, _others, _body);
+}
+
+void DenseLocateStmt::accept(IRVisitor *v) const {
+    v->visit(this);
+}
+
+const std::shared_ptr<const DenseLocateStmt> DenseLocateStmt::make(const ArrayLevel &_bound, const IteratorSet &_iterators, const Stmt &_definitions,
+                                                                   const Expr &_guard, const Stmt &_body) {
+    return make_tagged_node<DenseLocateStmt>(_bound, _iterators, _definitions, _guard, _body);
+}
+
+void DenseRunStmt::accept(IRVisitor *v) const {
+    v->visit(this);
+}
+
+const std::shared_ptr<const DenseRunStmt> DenseRunStmt::make(const IteratorSet &_iterators, const uint64_t _width, const Stmt &_body) {
+    return make_tagged_node<DenseRunStmt>(_iterators, _width, _body);
+}
+
+void InterleavedLoopStmt::accept(IRVisitor *v) const {
+    v->visit(this);
+}
+
+const std::shared_ptr<const InterleavedLoopStmt> InterleavedLoopStmt::make(const ArrayLevel &_iterator, const uint64_t _streams, const uint64_t _distance,
+                                                                           const IteratorSet &_gathered, const Stmt &_body) {
+    return make_tagged_node<InterleavedLoopStmt>(_iterator, _streams, _distance, _gathered, _body);
+}
+
+void PartitionedForStmt::accept(IRVisitor *v) const {
+    v->visit(this);
+}
+
+const std::shared_ptr<const PartitionedForStmt> PartitionedForStmt::make(const ArrayLevel &_extent, const IteratorSet &_compressed, const Stmt &_body) {
+    return make_tagged_node<PartitionedForStmt>(_extent, _compressed, _body);
+}
+
+const std::shared_ptr<const PartitionedForStmt> PartitionedForStmt::make(const ArrayLevel &_extent, const IteratorSet &_compressed, const Stmt &_body,
+                                                                         const Partitioning _partitioning, const uint64_t _grain) {
+    return make_tagged_node<PartitionedForStmt>(_extent, _compressed, _body, _partitioning, _grain);
+}
+
+const std::shared_ptr<const PartitionedForStmt> PartitionedForStmt::make(const ArrayLevel &_extent, const IteratorSet &_compressed, const Stmt &_body,
+                                                                         const Partitioning _partitioning, const uint64_t _grain,
+                                                                         const std::string &_position_operand, const bool _parallel) {
+    return make_tagged_node<PartitionedForStmt>(_extent, _compressed, _body, _partitioning, _grain, _position_operand, _parallel);
+}
+
+void ShardStmt::accept(IRVisitor *v) const {
+    v->visit(this);
+}
+
+const std::shared_ptr<const ShardStmt> ShardStmt::make(const ArrayLevel &_extent, const IteratorSet &_compressed, const Stmt &_body) {
+    return make_tagged_node<ShardStmt>(_extent, _compressed, _body);
 }
 
 void IncrementIterator::accept(IRVisitor *v) const {
@@ -72,11 +227,19 @@ void IncrementIterator::accept(IRVisitor *v) const {
 }
 
 const std::shared_ptr<const IncrementIterator> IncrementIterator::make(const ArrayLevel &_array) {
-    return std::make_shared<IncrementIterator>(_array);
+    return make_tagged_node<IncrementIterator>(_array);
 }
 
 const std::shared_ptr<const IncrementIterator> IncrementIterator::make(const ArrayLevel &_array, const bool _always) {
-    return std::make_shared<IncrementIterator>(_array, _always);
+    return make_tagged_node<IncrementIterator>(_array, _always);
+}
+
+void IncrementCounter::accept(IRVisitor *v) const {
+    v->visit(this);
+}
+
+const std::shared_ptr<const IncrementCounter> IncrementCounter::make(const uint64_t _index) {
+    return make_tagged_node<IncrementCounter>(_index);
 }
 
 void CompressedIndexDefinition::accept(IRVisitor *v) const {
@@ -84,7 +247,7 @@ void CompressedIndexDefinition::accept(IRVisitor *v) const {
 }
 
 const std::shared_ptr<const CompressedIndexDefinition> CompressedIndexDefinition::make(const ArrayLevel &_array) {
-    return std::make_shared<CompressedIndexDefinition>(_array);
+    return make_tagged_node<CompressedIndexDefinition>(_array);
 }
 
 void LogicalIndexDefinition::accept(IRVisitor *v) const {
@@ -92,7 +255,7 @@ void LogicalIndexDefinition::accept(IRVisitor *v) const {
 }
 
 const std::shared_ptr<const LogicalIndexDefinition> LogicalIndexDefinition::make(const IteratorSet &_iterators) {
-    return std::make_shared<LogicalIndexDefinition>(_iterators);
+    return make_tagged_node<LogicalIndexDefinition>(_iterators);
 }
 
 void IteratorDefinition::accept(IRVisitor *v) const {
@@ -100,7 +263,7 @@ void IteratorDefinition::accept(IRVisitor *v) const {
 }
 
 const std::shared_ptr<const IteratorDefinition> IteratorDefinition::make(const IteratorSet &_iterators) {
-    return std::make_shared<IteratorDefinition>(_iterators);
+    return make_tagged_node<IteratorDefinition>(_iterators);
 }
 
 void ArrayAssignment::accept(IRVisitor *v) const {
@@ -108,7 +271,11 @@ void ArrayAssignment::accept(IRVisitor *v) const {
 }
 
 const std::shared_ptr<const ArrayAssignment> ArrayAssignment::make(const ArrayLevel &_array, const Expr &_value) {
-    return std::make_shared<ArrayAssignment>(_array, _value);
+    return make_tagged_node<ArrayAssignment>(_array, _value);
+}
+
+const std::shared_ptr<const ArrayAssignment> ArrayAssignment::make(const ArrayLevel &_array, const Expr &_value, const bool _accumulate) {
+    return make_tagged_node<ArrayAssignment>(_array, _value, _accumulate);
 }
 
 }  // namespace LIR
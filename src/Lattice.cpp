@@ -2,13 +2,12 @@
 #include "Lattice.h"
 
 #include <algorithm>
-#include <iostream>
-#include <ostream>
-#include <set>
+#include <cassert>
+#include <memory>
+#include <unordered_map>
 
 #include "Expr.h"
 #include "IRVisitor.h"
-#include "IRPrinter.h"
 #include "SetExpr.h"
 #include "GatherIteratorSet.h"
 #include "SetExprUtils.h"
@@ -16,76 +15,254 @@
 
 namespace {
 
-// For debugging.
-void print_merge_lattice(std::ostream &stream, const MergeLattice &lattice) {
-    for (const auto &p : lattice.node_map) {
-        stream << "--------------------\n";
-        for (const auto &i : p.second->iterators) {
-            stream << i.name << "_i_" << ((i.format == Format::Compressed) ? "c" : "d") << "\n";
-        }
-        stream << "----------\n";
-        stream << p.second->body;
-        stream << "--------------------\n";
+// What is left of a node of a set expression once some operands are removed
+// from it (see get_simplified_set_expr).
+enum class NodeState {
+    Present,
+    // Removed, e.g. a removed compressed operand, or an intersection with a
+    // removed operand: drop it from an enclosing union.
+    Empty,
+    // A removed dense operand of a union covers every coordinate, so the
+    // enclosing unions have no point left without it.
+    Killed,
+};
+
+// Builds the points of a lattice as masks of the operands they cover. The
+// set expression is flattened once; each point is then simplified from its
+// mask, and only the first time the mask is reached.
+class LatticeBuilder {
+public:
+    LatticeBuilder(const SetExpr &sexpr, const FormatMap &formats, MergeLattice &lattice)
+        : formats(formats), lattice(lattice) {
+        flatten(sexpr);
     }
-}
 
-}  // namespace
+    MergePoint *build(const IndexStmt &body) {
+        return build(OperandMask(lattice.operands.size(), true), body, false);
+    }
+
+private:
+    struct Node {
+        SetExprKind kind;
+        // Children of a union or intersection.
+        size_t a = 0, b = 0;
+        // Operand of an ArrayDim.
+        size_t operand = 0;
+        SetExpr sexpr;
+    };
 
+    // The states of every node when only the operands in mask are left, and
+    // whether what is left of each node contains a compressed operand.
+    struct Evaluation {
+        std::vector<NodeState> states;
+        std::vector<bool> sparse;
 
-MergePoint* build_merge_lattice(const SetExpr &sexpr, const IndexStmt &body, const FormatMap &formats, MergeLattice &lattice) {
-    if(lattice.node_map.find(sexpr) != lattice.node_map.end()) {
-        // Node already exists
-        return lattice.node_map[sexpr];
+        bool present(const size_t node) const {
+            return states[node] == NodeState::Present;
+        }
+    };
+
+    // What is left of the set expression: its operands, and optionally the
+    // simplified expression and its iterators and locators.
+    struct Remainder {
+        OperandMask operands;
+        std::vector<size_t> iterators;
+        std::vector<size_t> locators;
+
+        // Nothing left of n operands.
+        explicit Remainder(const size_t n)
+            : operands(n) {}
+    };
+
+    size_t flatten(const SetExpr &sexpr) {
+        Node node;
+        node.kind = sexpr.ptr->kind;
+        node.sexpr = sexpr;
+        switch (node.kind) {
+        case SetExprKind::ArrayDim: {
+            const Access &access = sexpr.as<ArrayDim>()->access;
+            auto [it, inserted] = operand_index.emplace(access.name, lattice.operands.size());
+            if (inserted) {
+                lattice.operands.push_back(LIR::access_to_array_level(access, formats));
+            }
+            node.operand = it->second;
+            break;
+        }
+        case SetExprKind::Union: {
+            auto u = sexpr.as<Union>();
+            node.a = flatten(u->a);
+            node.b = flatten(u->b);
+            break;
+        }
+        case SetExprKind::Intersection: {
+            auto i = sexpr.as<Intersection>();
+            node.a = flatten(i->a);
+            node.b = flatten(i->b);
+            break;
+        }
+        }
+        nodes.push_back(node);
+        return nodes.size() - 1;
     }
 
-    auto [iterators, locators] = split_iterators_locators(sexpr, formats);
-    // if no iterators are left (everything is dense, use any dense locator as an iterator)
-    if (iterators.empty()) {
-        assert(!locators.empty());
-        iterators.push_back(locators.front());
+    bool compressed(const size_t operand) const {
+        return lattice.operands[operand].format == Format::Compressed;
     }
-    auto *new_point = new MergePoint{.sexpr = sexpr, .iterators = std::move(iterators), .locators = std::move(locators), .children = {}, .body = body};
-
-    std::vector<MergePoint*> children;
-    for(auto iterator : new_point->iterators) {
-        auto newSetExpr = get_simplified_set_expr(sexpr, iterator);
-        if(!newSetExpr.defined()) continue;
-        auto newBody = get_simplified_index_stmt(body, newSetExpr, formats);
-        children.push_back(build_merge_lattice(newSetExpr, newBody, formats, lattice));
+
+    // Nodes are in post-order, so children are evaluated first.
+    Evaluation evaluate(const OperandMask &mask) const {
+        Evaluation e{std::vector<NodeState>(nodes.size()), std::vector<bool>(nodes.size())};
+        for (size_t n = 0; n < nodes.size(); n++) {
+            const Node &node = nodes[n];
+            switch (node.kind) {
+            case SetExprKind::ArrayDim:
+                e.states[n] = mask[node.operand] ? NodeState::Present
+                              : compressed(node.operand) ? NodeState::Empty : NodeState::Killed;
+                e.sparse[n] = compressed(node.operand);
+                break;
+            case SetExprKind::Union:
+                if (e.states[node.a] == NodeState::Killed || e.states[node.b] == NodeState::Killed) {
+                    e.states[n] = NodeState::Killed;
+                } else if (e.present(node.a) || e.present(node.b)) {
+                    e.states[n] = NodeState::Present;
+                    e.sparse[n] = (e.present(node.a) && e.sparse[node.a]) || (e.present(node.b) && e.sparse[node.b]);
+                } else {
+                    e.states[n] = NodeState::Empty;
+                }
+                break;
+            case SetExprKind::Intersection:
+                e.states[n] = (e.present(node.a) && e.present(node.b)) ? NodeState::Present : NodeState::Empty;
+                e.sparse[n] = e.sparse[node.a] && e.sparse[node.b];
+                break;
+            }
+        }
+        return e;
     }
-    new_point->children = std::move(children);
-    lattice.node_map[sexpr] = new_point;
-    return new_point;
-}
 
-MergeLattice MergeLattice::make(const SetExpr &sexpr, const IndexStmt &body, const FormatMap &formats) {
-    MergeLattice lattice;
-    lattice.root = build_merge_lattice(sexpr, body, formats, lattice);
-    return lattice;
-}
+    // Walks what is left of node, as split_iterators_locators walks the
+    // simplified set expression. Unions with one side left are transparent.
+    SetExpr remainder(const Evaluation &e, const size_t n, const bool under_intersect, const bool under_dense_union,
+                      const bool rebuild, Remainder &r) const {
+        const Node &node = nodes[n];
+        switch (node.kind) {
+        case SetExprKind::ArrayDim:
+            r.operands[node.operand] = true;
+            if ((under_intersect || under_dense_union) && !compressed(node.operand)) {
+                r.locators.push_back(node.operand);
+            } else {
+                r.iterators.push_back(node.operand);
+            }
+            return node.sexpr;
+        case SetExprKind::Union: {
+            if (!e.present(node.a) || !e.present(node.b)) {
+                return remainder(e, e.present(node.a) ? node.a : node.b, under_intersect, under_dense_union, rebuild, r);
+            }
+            const bool dense_union = under_dense_union || !e.sparse[n];
+            SetExpr a = remainder(e, node.a, under_intersect, dense_union, rebuild, r);
+            SetExpr b = remainder(e, node.b, under_intersect, dense_union, rebuild, r);
+            return rebuild ? SetExpr(Union::make(a, b)) : SetExpr();
+        }
+        case SetExprKind::Intersection: {
+            SetExpr a = remainder(e, node.a, true, under_dense_union, rebuild, r);
+            SetExpr b = remainder(e, node.b, true, under_dense_union, rebuild, r);
+            return rebuild ? SetExpr(Intersection::make(a, b)) : SetExpr();
+        }
+        }
+        return SetExpr();
+    }
+
+    // The point of the operands in mask, or nullptr if no point is left. Its
+    // body is body, simplified to the point if simplify is set.
+    MergePoint *build(const OperandMask &mask, const IndexStmt &body, const bool simplify) {
+        const size_t root = nodes.size() - 1;
+        const Evaluation e = evaluate(mask);
+        if (!e.present(root)) {
+            return nullptr;
+        }
+        Remainder r(lattice.operands.size());
+        remainder(e, root, false, false, false, r);
+        if (auto existing = points.find(r.operands); existing != points.end()) {
+            return existing->second;
+        }
+
+        r = Remainder(lattice.operands.size());
+        auto point = std::make_unique<MergePoint>();
+        point->sexpr = remainder(e, root, false, false, true, r);
+        // An operand that appears several times (e.g. in a fused set
+        // expression) is iterated, or located, once. Iterating it takes precedence.
+        std::vector<bool> seen(lattice.operands.size());
+        for (const size_t operand : r.iterators) {
+            if (!seen[operand]) {
+                seen[operand] = true;
+                point->iterators.push_back(lattice.operands[operand]);
+            }
+        }
+        for (const size_t operand : r.locators) {
+            if (!seen[operand]) {
+                seen[operand] = true;
+                point->locators.push_back(lattice.operands[operand]);
+            }
+        }
+        // if no iterators are left (everything is dense, use any dense locator as an iterator)
+        if (point->iterators.empty()) {
+            assert(!point->locators.empty());
+            point->iterators.push_back(point->locators.front());
+        }
+        point->body = simplify ? get_simplified_index_stmt(body, point->sexpr, formats) : body;
+        point->operands = std::move(r.operands);
+        point->index = lattice.points.size();
 
+        MergePoint *new_point = point.get();
+        lattice.points.push_back(std::move(point));
+        points.emplace(new_point->operands, new_point);
+        lattice.node_map[new_point->sexpr] = new_point;
 
-void toposortDfs(const MergePoint &point, std::map<SetExpr, bool, SetComparator> &visited, std::vector<const MergePoint*> &result) {
-    if(visited.find(point.sexpr) != visited.end()) {
+        for (const auto &iterator : new_point->iterators) {
+            OperandMask child_mask = new_point->operands;
+            child_mask[operand_index.at(iterator.name)] = false;
+            if (MergePoint *child = build(child_mask, new_point->body, true)) {
+                new_point->children.push_back(child);
+            }
+        }
+        return new_point;
+    }
+
+    const FormatMap &formats;
+    MergeLattice &lattice;
+    // The set expression, in post-order (the root last).
+    std::vector<Node> nodes;
+    std::unordered_map<Symbol, size_t> operand_index;
+    std::unordered_map<OperandMask, MergePoint *> points;
+};
+
+void toposort_dfs(const MergePoint &point, std::vector<bool> &visited, std::vector<const MergePoint*> &result) {
+    if (visited[point.index]) {
         return;
     }
-    visited[point.sexpr] = true;
-    for(auto child : point.children) {
-        toposortDfs(*child, visited, result);
+    visited[point.index] = true;
+    for (auto child : point.children) {
+        toposort_dfs(*child, visited, result);
     }
     result.push_back(&point);
 }
 
-std::vector<const MergePoint*> MergeLattice::get_sub_points(const MergePoint &point) const {
-    std::vector<const MergePoint*> out;
-    std::map<SetExpr, bool, SetComparator> visited;
+}  // namespace
+
 
-    toposortDfs(point, visited, out);
-    std::reverse(out.begin(), out.end());
+MergeLattice MergeLattice::make(const SetExpr &sexpr, const IndexStmt &body, const FormatMap &formats) {
+    MergeLattice lattice;
+    LatticeBuilder builder(sexpr, formats, lattice);
+    lattice.root = builder.build(body);
 
-    if (!out.empty() && out.front() == &point) {
-        out.erase(out.begin());
+    for (const auto &point : lattice.points) {
+        std::vector<bool> visited(lattice.points.size());
+        toposort_dfs(*point, visited, point->sub_points);
+        point->sub_points.pop_back();
+        std::reverse(point->sub_points.begin(), point->sub_points.end());
     }
-    return out;
+    return lattice;
 }
 
+const std::vector<const MergePoint*> &MergeLattice::get_sub_points(const MergePoint &point) const {
+    return point.sub_points;
+}
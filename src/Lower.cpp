@@ -1,8 +1,12 @@
 #include "Lower.h"
 
 #include <algorithm>
+#include <map>
 #include <set>
+#include <sstream>
 
+#include "CostModel.h"
+#include "CSE.h"
 #include "IRVisitor.h"
 #include "IRPrinter.h"
 #include "GatherIteratorSet.h"
@@ -41,49 +45,317 @@ IndexStmt lower(const Assignment &assignment) {
     return cin;
 }
 
-LIR::Stmt lower(const IndexStmt &stmt, const FormatMap &formats) {
-    auto forall = std::dynamic_pointer_cast<const ForAll>(stmt.ptr);
-    MergeLattice lattice = MergeLattice::make(forall->sexpr, forall->body, formats);
+IndexStmt lower(const std::vector<Assignment> &assignments) {
+    assert(!assignments.empty());
+    SetExpr sexpr;
+    std::vector<IndexStmt> stmts;
+    for (const auto &assignment : assignments) {
+        auto forall = lower(assignment).as<ForAll>();
+        if (sexpr.defined()) {
+            sexpr = Union::make(sexpr, forall->sexpr);
+        } else {
+            sexpr = forall->sexpr;
+        }
+        stmts.push_back(forall->body);
+    }
+    return ForAll::make(sexpr, Multi::make(stmts));
+}
 
-    auto lower_assign_stmt = [&](const MergePoint &point) {
-        IndexStmt stmt = point.body;
-        auto assign_stmt = std::dynamic_pointer_cast<const ArrayAssignment>(stmt.ptr);
-        assert(assign_stmt != nullptr);
+namespace {
 
-        struct LExprLowerer : public IRVisitor {
-            LIR::Expr lir_expr;
-            FormatMap formats;
-            LExprLowerer(const FormatMap &formats) : formats(formats) {}
+bool is_all_dense(const LIR::IteratorSet &arrays) {
+    return std::all_of(arrays.iterators.cbegin(), arrays.iterators.cend(),
+                       [](const LIR::ArrayLevel &a) { return a.format == Format::Dense; });
+}
+
+// Loops co-iterating this many iterators dispatch their lattice points with a
+// bitmask switch rather than an if/else chain. The upper bound keeps the
+// number of case labels (2^k) reasonable.
+constexpr size_t switch_min_iterators = 3;
+constexpr size_t switch_max_iterators = 10;
+
+// Dispatch lattice points on a bitmask of which iterators match the logical
+// index. Every reachable mask selects the first point (in if/else order) whose
+// iterators it covers, and points with identical bodies share one case.
+LIR::Stmt lower_switch(const std::vector<LIR::ArrayLevel> &iters,
+                       const std::vector<LIR::IteratorSet> &conditions,
+                       const std::vector<LIR::Stmt> &bodies) {
+    std::map<std::string, uint64_t> bits;
+    for (size_t i = 0; i < iters.size(); i++) {
+        bits[iters[i].name] = uint64_t(1) << i;
+    }
+    std::vector<uint64_t> condition_masks;
+    for (const auto &condition : conditions) {
+        uint64_t mask = 0;
+        for (const auto &iter : condition.iterators) {
+            mask |= bits.at(iter.name);
+        }
+        condition_masks.push_back(mask);
+    }
 
-            virtual void visit(const ArrayRead *arrayread) {
-                lir_expr = LIR::ArrayAccess::make(LIR::access_to_array_level(arrayread->access, formats));
+    std::vector<std::vector<uint64_t>> cases;
+    std::vector<LIR::Stmt> case_bodies;
+    std::map<std::string, size_t> seen_bodies;
+    std::vector<size_t> case_of_condition(conditions.size(), SIZE_MAX);
+    for (uint64_t mask = 1; mask < (uint64_t(1) << iters.size()); mask++) {
+        for (size_t c = 0; c < conditions.size(); c++) {
+            if ((condition_masks[c] & mask) != condition_masks[c]) {
+                continue;
+            }
+            if (case_of_condition[c] == SIZE_MAX) {
+                std::ostringstream printed;
+                printed << bodies[c];
+                auto [it, inserted] = seen_bodies.emplace(printed.str(), case_bodies.size());
+                if (inserted) {
+                    cases.emplace_back();
+                    case_bodies.push_back(bodies[c]);
+                }
+                case_of_condition[c] = it->second;
             }
+            cases[case_of_condition[c]].push_back(mask);
+            break;
+        }
+    }
+
+    return LIR::SwitchStmt::make(LIR::IteratorSet{iters}, cases, case_bodies);
+}
+
+// Assignments reading at least this many compressed operands are co-iterated
+// with a heap-based k-way merge; their lattice would have up to 2^k points.
+constexpr size_t kway_min_iterators = 8;
+
+// Beyond this many compressed operands, the cost model does not consider
+// co-iterating the lattice at all: building it alone would take too long.
+constexpr size_t merge_max_compressed = 12;
+
+// Runs of this many consecutive coordinates, shared by every compressed
+// iterator of a loop, are processed as one vectorizable block.
+constexpr uint64_t dense_run_width = 8;
+
+// Interleaved loops prefetch the dense gathers of each stream this many
+// positions ahead.
+constexpr uint64_t interleave_prefetch_distance = 4;
+
+// Dense arrays read or written by stmt, in order of first access.
+LIR::IteratorSet gather_dense_arrays(const LIR::Stmt &stmt) {
+    struct DenseGatherer : public IRVisitor {
+        std::vector<LIR::ArrayLevel> arrays;
 
-            virtual void visit(const Add *add) {
-                add->a.accept(this);
-                auto a = std::move(lir_expr);
-                add->b.accept(this);
-                auto b = std::move(lir_expr);
-                lir_expr = LIR::Add::make(a, b);
+        void add(const LIR::ArrayLevel &array) {
+            if (array.format == Format::Dense &&
+                std::none_of(arrays.cbegin(), arrays.cend(), [&](const LIR::ArrayLevel &a) { return a.name == array.name; })) {
+                arrays.push_back(array);
             }
+        }
+
+        void visit(const LIR::ArrayAccess *node) override {
+            add(node->array);
+        }
+
+        void visit(const LIR::ArrayAssignment *node) override {
+            add(node->array);
+            IRVisitor::visit(node);
+        }
+    };
+    DenseGatherer gatherer;
+    stmt.accept(&gatherer);
+    return LIR::IteratorSet{gatherer.arrays};
+}
+
+// Whether every array stmt assigns to is dense.
+bool writes_dense_only(const LIR::Stmt &stmt) {
+    struct OutputChecker : public IRVisitor {
+        bool dense = true;
+        void visit(const LIR::ArrayAssignment *node) override {
+            dense &= node->array.format == Format::Dense;
+        }
+    };
+    OutputChecker checker;
+    stmt.accept(&checker);
+    return checker.dense;
+}
 
-            virtual void visit(const Mul *mul) {
-                mul->a.accept(this);
-                auto a = std::move(lir_expr);
-                mul->b.accept(this);
-                auto b = std::move(lir_expr);
-                lir_expr = LIR::Mul::make(a, b);
+// With a profile, a case taken by at least likely_case_ratio of the steps
+// that test it is predicted taken, and one taken by at most
+// unlikely_case_ratio predicted not taken. Cases taken by less than
+// cold_case_ratio of all steps of their loop are moved out of line.
+constexpr double likely_case_ratio = 0.9;
+constexpr double unlikely_case_ratio = 0.1;
+constexpr double cold_case_ratio = 0.01;
+
+// Profiling of the cases of lattice loops (see Profile.h): counting them in
+// a training kernel, or ordering them by a profile.
+struct BranchProfiling {
+    // Keys of the counters of a training kernel, by index, or null.
+    std::vector<std::string> *counter_keys = nullptr;
+    const BranchProfile *profile = nullptr;
+
+    // Increment the counter of key, shared by every event with that key.
+    LIR::Stmt count(const std::string &key) const {
+        auto found = std::find(counter_keys->cbegin(), counter_keys->cend(), key);
+        if (found == counter_keys->cend()) {
+            counter_keys->push_back(key);
+            found = counter_keys->cend() - 1;
+        }
+        return LIR::IncrementCounter::make(found - counter_keys->cbegin());
+    }
+};
+
+// Dispatch the cases of the loop over iters with an if/else chain ordered by
+// how often profile says each was taken, most often first, with hints. A case
+// still precedes every case whose iterators it covers: their conditions hold
+// wherever its does.
+LIR::Stmt lower_profiled_cases(const std::vector<LIR::ArrayLevel> &iters,
+                               const std::vector<LIR::IteratorSet> &conditions,
+                               const std::vector<LIR::Stmt> &bodies,
+                               const BranchProfile &profile) {
+    auto covers = [](const LIR::IteratorSet &a, const LIR::IteratorSet &b) {
+        return std::all_of(b.iterators.cbegin(), b.iterators.cend(), [&](const LIR::ArrayLevel &iter) {
+            return std::any_of(a.iterators.cbegin(), a.iterators.cend(),
+                               [&](const LIR::ArrayLevel &other) { return other.name == iter.name; });
+        });
+    };
+    std::vector<uint64_t> hits;
+    for (const auto &condition : conditions) {
+        hits.push_back(profile.count(case_profile_key(iters, condition.iterators)));
+    }
+
+    std::vector<LIR::IteratorSet> ordered_conditions;
+    std::vector<LIR::Stmt> ordered_bodies;
+    std::vector<LIR::BranchHint> hints;
+    std::vector<bool> placed(conditions.size(), false);
+    const double steps = double(profile.count(loop_profile_key(iters)));
+    double reached = steps;
+    for (size_t n = 0; n < conditions.size(); n++) {
+        // The most frequent case not covered by one still to place; the
+        // first one on ties, keeping the lattice order.
+        size_t next = SIZE_MAX;
+        for (size_t c = 0; c < conditions.size(); c++) {
+            if (placed[c] || (next != SIZE_MAX && hits[c] <= hits[next])) {
+                continue;
+            }
+            bool covered = false;
+            for (size_t o = 0; o < conditions.size() && !covered; o++) {
+                covered = o != c && !placed[o] && covers(conditions[o], conditions[c]);
             }
-        };
-        LExprLowerer lowerer(formats);
-        assign_stmt->rhs.accept(&lowerer);
+            if (!covered) {
+                next = c;
+            }
+        }
+        placed[next] = true;
+        ordered_conditions.push_back(conditions[next]);
+        ordered_bodies.push_back(bodies[next]);
 
-        return LIR::ArrayAssignment::make(LIR::access_to_array_level(assign_stmt->lhs, formats), lowerer.lir_expr);
+        const double taken = double(hits[next]);
+        if (taken < cold_case_ratio * steps) {
+            hints.push_back(LIR::BranchHint::Cold);
+        } else if (reached > 0 && taken >= likely_case_ratio * reached) {
+            hints.push_back(LIR::BranchHint::Likely);
+        } else if (reached > 0 && taken <= unlikely_case_ratio * reached) {
+            hints.push_back(LIR::BranchHint::Unlikely);
+        } else {
+            hints.push_back(LIR::BranchHint::None);
+        }
+        reached -= taken;
+    }
+    return LIR::IfStmt::make(ordered_conditions, ordered_bodies, hints);
+}
+
+// Lower an ArrayAssignment of CIN into LIR, reading operands at their
+// current iterators. If accumulate is set, the output is added into rather
+// than overwritten.
+LIR::Stmt lower_assign(const IndexStmt &stmt, const FormatMap &formats, const bool accumulate) {
+    auto assign_stmt = stmt.as<ArrayAssignment>();
+    assert(assign_stmt != nullptr);
+
+    struct LExprLowerer : public IRVisitor {
+        LIR::Expr lir_expr;
+        FormatMap formats;
+        LExprLowerer(const FormatMap &formats) : formats(formats) {}
+
+        virtual void visit(const ArrayRead *arrayread) {
+            lir_expr = LIR::ArrayAccess::make(LIR::access_to_array_level(arrayread->access, formats));
+        }
+
+        virtual void visit(const Add *add) {
+            add->a.accept(this);
+            auto a = std::move(lir_expr);
+            add->b.accept(this);
+            auto b = std::move(lir_expr);
+            lir_expr = LIR::Add::make(a, b);
+        }
+
+        virtual void visit(const Mul *mul) {
+            mul->a.accept(this);
+            auto a = std::move(lir_expr);
+            mul->b.accept(this);
+            auto b = std::move(lir_expr);
+            lir_expr = LIR::Mul::make(a, b);
+        }
     };
+    LExprLowerer lowerer(formats);
+    assign_stmt->rhs.accept(&lowerer);
 
-    auto lower_while_loop = [&](const MergePoint &point) {
+    return LIR::ArrayAssignment::make(LIR::access_to_array_level(assign_stmt->lhs, formats), lowerer.lir_expr, accumulate);
+}
+
+// Lower a ForAll by co-iterating its merge lattice: one while loop per
+// lattice point, each guarding the bodies of its sub-points.
+// If accumulate is set, the output is added into rather than overwritten.
+// The schedule's vector width and unroll count apply to every loop.
+LIR::Stmt lower_merge(const IndexStmt &stmt, const FormatMap &formats, const bool accumulate, const Schedule &schedule,
+                      const BranchProfiling &profiling) {
+    auto forall = stmt.as<ForAll>();
+    MergeLattice lattice = MergeLattice::make(forall->sexpr, forall->body, formats);
+    const uint64_t run_width = schedule.vectorize_width != 0 ? schedule.vectorize_width : dense_run_width;
+
+    // The body of a point: its assignment, or each assignment of a Multi
+    // that is defined at the point.
+    // Values the body uses more than once are computed once.
+    // A point guards a case in the loop of every point that dominates it, so
+    // bodies are lowered once, by point index.
+    std::vector<LIR::Stmt> lowered_bodies(lattice.points.size());
+    auto lower_assign_stmt = [&](const MergePoint &point) -> LIR::Stmt {
+        LIR::Stmt &lowered = lowered_bodies[point.index];
+        if (lowered.defined()) {
+            return lowered;
+        }
+        if (auto multi = point.body.as<Multi>()) {
+            std::vector<LIR::Stmt> stmts;
+            for (const auto &stmt : multi->stmts) {
+                stmts.push_back(lower_assign(stmt, formats, accumulate));
+            }
+            lowered = eliminate_common_subexpressions(LIR::SequenceStmt::make(stmts));
+        } else {
+            lowered = eliminate_common_subexpressions(lower_assign(point.body, formats, accumulate));
+        }
+        return lowered;
+    };
+
+    auto lower_while_loop = [&](const MergePoint &point) -> LIR::Stmt {
         std::vector<LIR::Stmt> body;
         auto iters = point.iterators;
+
+        // A loop over one compressed operand only gathers from dense arrays,
+        // so it can visit its positions in any order.
+        if (schedule.interleave_streams != 0 && iters.size() == 1 && iters[0].format == Format::Compressed &&
+            lattice.get_sub_points(point).empty()) {
+            const LIR::Stmt assign = lower_assign_stmt(point);
+            assert(writes_dense_only(assign));
+            return LIR::InterleavedLoopStmt::make(
+                iters[0], schedule.interleave_streams, interleave_prefetch_distance, gather_dense_arrays(assign),
+                LIR::SequenceStmt::make({
+                    LIR::CompressedIndexDefinition::make(iters[0]),
+                    LIR::LogicalIndexDefinition::make(LIR::IteratorSet{iters}),
+                    assign,
+                })
+            );
+        }
+        const bool all_compressed = std::all_of(iters.cbegin(), iters.cend(),
+                                                [](const LIR::ArrayLevel &a) { return a.format == Format::Compressed; });
+        if (all_compressed) {
+            body.push_back(LIR::DenseRunStmt::make(LIR::IteratorSet{iters}, run_width, lower_assign_stmt(point)));
+        }
         for (const auto &iter : iters) {
             if(iter.format == Format::Compressed) {
                 body.push_back(LIR::CompressedIndexDefinition::make(iter));
@@ -102,7 +374,25 @@ LIR::Stmt lower(const IndexStmt &stmt, const FormatMap &formats) {
             if_conditions.push_back(LIR::IteratorSet{sub_point->iterators});
             if_bodies.push_back(lower_assign_stmt(*sub_point));
         }
-        if(if_conditions.size() > 1 || point.iterators.size() > 1) {
+        const bool dispatch = if_conditions.size() > 1 || point.iterators.size() > 1;
+        // A training kernel counts the steps that dispatch, and the steps
+        // taking each case.
+        if (dispatch && profiling.counter_keys != nullptr) {
+            body.push_back(profiling.count(loop_profile_key(iters)));
+            for (size_t c = 0; c < if_bodies.size(); c++) {
+                if_bodies[c] = LIR::SequenceStmt::make({
+                    profiling.count(case_profile_key(iters, if_conditions[c].iterators)),
+                    if_bodies[c],
+                });
+            }
+        }
+        if (dispatch && profiling.profile != nullptr && profiling.profile->count(loop_profile_key(iters)) != 0) {
+            // Once ordered by frequency, the chain tests the hot cases
+            // first, so it is used instead of a switch.
+            body.push_back(lower_profiled_cases(iters, if_conditions, if_bodies, *profiling.profile));
+        } else if (if_conditions.size() > 1 && iters.size() >= switch_min_iterators && iters.size() <= switch_max_iterators) {
+            body.push_back(lower_switch(iters, if_conditions, if_bodies));
+        } else if(dispatch) {
             body.push_back(LIR::IfStmt::make(if_conditions, if_bodies));
         } else {
             body.push_back(if_bodies[0]);
@@ -112,12 +402,23 @@ LIR::Stmt lower(const IndexStmt &stmt, const FormatMap &formats) {
             body.push_back(LIR::IncrementIterator::make(iter, !(iter.format == Format::Compressed) || iters.size() == 1));
         }
 
+        // While loops don't vectorize, their runs do.
         return LIR::WhileStmt::make(
             LIR::IteratorSet{iters},
-            LIR::SequenceStmt::make(body)
+            LIR::SequenceStmt::make(body),
+            LIR::LoopHints{0, schedule.unroll_count}
         );
     };
 
+    // When every operand (and the output) is dense, the lattice collapses to a
+    // single point that visits every coordinate; emit a plain counted loop
+    // instead of a while loop with min() and trivially true guards.
+    LIR::IteratorSet arrays = gather_iterator_set(stmt, formats);
+    if (is_all_dense(arrays)) {
+        return LIR::ForStmt::make(lattice.root->iterators.front(), arrays, lower_assign_stmt(*lattice.root),
+                                  LIR::LoopHints{schedule.vectorize_width, schedule.unroll_count});
+    }
+
     std::vector<LIR::Stmt> stmts;
 
     stmts.push_back(LIR::IteratorDefinition::make(LIR::IteratorSet{lattice.root->iterators}));
@@ -129,3 +430,380 @@ LIR::Stmt lower(const IndexStmt &stmt, const FormatMap &formats) {
 
     return LIR::SequenceStmt::make(stmts);
 }
+
+// Whether expr contains an addition.
+bool contains_add(const Expr &expr) {
+    struct HasAdd : public IRVisitor {
+        bool found = false;
+        void visit(const Add *) override {
+            found = true;
+        }
+    };
+    HasAdd checker;
+    expr.accept(&checker);
+    return checker.found;
+}
+
+// Whether expr reads the array named name.
+bool reads_array(const Expr &expr, const std::string &name) {
+    struct ReadsArray : public IRVisitor {
+        const std::string &name;
+        bool found = false;
+        explicit ReadsArray(const std::string &_name)
+            : name(_name) {}
+        void visit(const ArrayRead *node) override {
+            found |= node->access.name == name;
+        }
+    };
+    ReadsArray checker(name);
+    expr.accept(&checker);
+    return checker.found;
+}
+
+// Flattens the left spine of a sum of products, ((t0 + t1) + t2) + ..., into
+// its terms. Returns false if the expression is not of that shape, i.e. if
+// any term itself contains an addition.
+bool get_sum_of_products(const Expr &expr, std::vector<Expr> &terms) {
+    Expr e = expr;
+    while (auto add = e.as<Add>()) {
+        terms.push_back(add->b);
+        e = add->a;
+    }
+    terms.push_back(e);
+    std::reverse(terms.begin(), terms.end());
+
+    for (const auto &term : terms) {
+        if (contains_add(term)) {
+            return false;
+        }
+    }
+    return terms.size() > 1;
+}
+
+// Lower a sum of products into a dense output without co-iterating the union.
+// The output is initialized from the leading term (or zeroed), and each
+// remaining term is then scattered into it by its own intersection loop:
+//   A(i) = t0
+//   A(i) += t1
+//   ...
+// Terms are accumulated in source order, so the result rounds exactly like
+// the left-associated sum the merge lattice would evaluate.
+LIR::Stmt lower_scatter(const Access &lhs, const std::vector<Expr> &terms, const FormatMap &formats, const Schedule &schedule,
+                        const BranchProfiling &profiling) {
+    std::vector<LIR::Stmt> stmts;
+    const LIR::ArrayLevel out = LIR::access_to_array_level(lhs, formats);
+
+    for (size_t t = 0; t < terms.size(); t++) {
+        const IndexStmt term = lower(Assignment(lhs, terms[t]));
+        const bool accumulate = (t != 0);
+        if (t == 0 && !is_all_dense(gather_iterator_set(term, formats))) {
+            // Sparse leading term, zero the output before scattering into it.
+            stmts.push_back(LIR::ForStmt::make(out, LIR::IteratorSet{{out}},
+                                               LIR::ArrayAssignment::make(out, LIR::Literal::make(0.0f)),
+                                               LIR::LoopHints{schedule.vectorize_width, schedule.unroll_count}));
+        }
+        // Each pass gets its own scope, so iterator names can be reused.
+        stmts.push_back(LIR::BlockStmt::make(lower_merge(term, formats, accumulate, schedule, profiling)));
+    }
+
+    return LIR::SequenceStmt::make(stmts);
+}
+
+// Lowers an expression under presence semantics, given a <name>_present flag
+// for each operand: a sum with one absent operand yields the other operand,
+// and a product is present only if both operands are. That is exactly what
+// the lattice point covering the present operands computes. Every
+// subexpression gets its own local, so the code stays linear in the size of
+// the expression, and operands are only read when present.
+struct PresenceLowerer : public IRVisitor {
+    LIR::Expr value;
+    LIR::Expr present;
+    std::vector<LIR::Stmt> definitions;
+    const FormatMap &formats;
+    PresenceLowerer(const FormatMap &formats) : formats(formats) {}
+
+    void define(const LIR::Expr &_value, const LIR::Expr &_present) {
+        const std::string name = "merge_t" + std::to_string(definitions.size() / 2);
+        definitions.push_back(LIR::VarDefinition::make(name, LIR::ScalarType::Float, _value));
+        definitions.push_back(LIR::VarDefinition::make(name + "_present", LIR::ScalarType::Bool, _present));
+        value = LIR::Var::make(name);
+        present = LIR::Var::make(name + "_present");
+    }
+
+    void visit(const ArrayRead *arrayread) override {
+        const auto array = LIR::access_to_array_level(arrayread->access, formats);
+        const auto array_present = LIR::Var::make(array.name + "_present");
+        define(LIR::Select::make(array_present, LIR::ArrayAccess::make(array), LIR::Literal::make(0.0f)), array_present);
+    }
+
+    void visit(const Add *add) override {
+        add->a.accept(this);
+        auto a = std::move(value);
+        auto pa = std::move(present);
+        add->b.accept(this);
+        auto b = std::move(value);
+        auto pb = std::move(present);
+        define(LIR::Select::make(pa, LIR::Select::make(pb, LIR::Add::make(a, b), a), b), LIR::Or::make(pa, pb));
+    }
+
+    void visit(const Mul *mul) override {
+        mul->a.accept(this);
+        auto a = std::move(value);
+        auto pa = std::move(present);
+        mul->b.accept(this);
+        auto b = std::move(value);
+        auto pb = std::move(present);
+        define(LIR::Mul::make(a, b), LIR::And::make(pa, pb));
+    }
+};
+
+// Lower by merging every operand with a k-way heap merge, without building
+// the merge lattice. Rather than one case per lattice point, each step
+// evaluates the expression under presence semantics (see PresenceLowerer).
+LIR::Stmt lower_kway(const ArrayAssignment &assign_stmt, const std::vector<LIR::ArrayLevel> &operands, const FormatMap &formats) {
+    PresenceLowerer lowerer(formats);
+    assign_stmt.rhs.accept(&lowerer);
+
+    return LIR::KWayMergeStmt::make(
+        LIR::IteratorSet{operands},
+        LIR::SequenceStmt::make(lowerer.definitions),
+        lowerer.present,
+        LIR::ArrayAssignment::make(LIR::access_to_array_level(assign_stmt.lhs, formats), lowerer.value)
+    );
+}
+
+// Lower assign, an ArrayAssignment of a product of compressed operands, by
+// walking operands[lead] and galloping the others to its coordinates (see
+// LIR::GallopStmt).
+LIR::Stmt lower_gallop(const IndexStmt &assign, const std::vector<LIR::ArrayLevel> &operands, const size_t lead,
+                       const FormatMap &formats) {
+    std::vector<LIR::ArrayLevel> others = operands;
+    others.erase(others.begin() + lead);
+    return LIR::SequenceStmt::make({
+        LIR::IteratorDefinition::make(LIR::IteratorSet{operands}),
+        LIR::GallopStmt::make(operands[lead], LIR::IteratorSet{others},
+                              eliminate_common_subexpressions(lower_assign(assign, formats, false))),
+    });
+}
+
+// Lower by visiting every coordinate of a dense output and locating each
+// compressed operand at it (see LIR::DenseLocateStmt), evaluating the
+// expression under presence semantics like lower_kway.
+LIR::Stmt lower_dense_locate(const ArrayAssignment &assign_stmt, const std::vector<LIR::ArrayLevel> &operands, const FormatMap &formats) {
+    PresenceLowerer lowerer(formats);
+    assign_stmt.rhs.accept(&lowerer);
+
+    const LIR::ArrayLevel out = LIR::access_to_array_level(assign_stmt.lhs, formats);
+    return LIR::SequenceStmt::make({
+        LIR::IteratorDefinition::make(LIR::IteratorSet{operands}),
+        LIR::DenseLocateStmt::make(out, LIR::IteratorSet{operands}, LIR::SequenceStmt::make(lowerer.definitions), lowerer.present,
+                                   LIR::ArrayAssignment::make(out, lowerer.value)),
+    });
+}
+
+// The terms of stmt's sum of products, if it can be lowered by scattering
+// them into a dense output (see lower_scatter). An output that is also read
+// can't be: scattering zeroes it first.
+bool get_scatter_terms(const ArrayAssignment &assign_stmt, const LIR::IteratorSet &arrays, const FormatMap &formats,
+                       std::vector<Expr> &terms) {
+    const LIR::ArrayLevel out = LIR::access_to_array_level(assign_stmt.lhs, formats);
+    return out.format == Format::Dense && !is_all_dense(arrays) && !reads_array(assign_stmt.rhs, assign_stmt.lhs.name) &&
+           get_sum_of_products(assign_stmt.rhs, terms);
+}
+
+// The compressed operands of stmt, if every operand is compressed.
+bool get_kway_operands(const IndexStmt &stmt, const FormatMap &formats, std::vector<LIR::ArrayLevel> &operands) {
+    const LIR::IteratorSet arrays = gather_iterator_set(stmt, formats);
+    operands.assign(arrays.iterators.cbegin() + 1, arrays.iterators.cend());
+    return std::all_of(operands.cbegin(), operands.cend(),
+                       [](const LIR::ArrayLevel &a) { return a.format == Format::Compressed; });
+}
+
+// The strategy lower(IndexStmt, FormatMap) picks without operand statistics.
+LoweringStrategy default_strategy(const ForAll &forall, const IndexStmt &stmt, const FormatMap &formats) {
+    // Fused outputs share one pass over their operands, so co-iterate them.
+    auto assign_stmt = forall.body.as<ArrayAssignment>();
+    if (!assign_stmt) {
+        return LoweringStrategy::Merge;
+    }
+
+    // Many compressed operands would give an exponentially large lattice.
+    std::vector<LIR::ArrayLevel> operands;
+    if (get_kway_operands(stmt, formats, operands) && operands.size() >= kway_min_iterators) {
+        return LoweringStrategy::KWayMerge;
+    }
+
+    // Unions into a dense output are cheaper to build one term at a time
+    // than by co-iterating every operand.
+    std::vector<Expr> terms;
+    if (get_scatter_terms(*assign_stmt, gather_iterator_set(stmt, formats), formats, terms)) {
+        return LoweringStrategy::Scatter;
+    }
+
+    return LoweringStrategy::Merge;
+}
+
+// Lower a ForAll over the whole coordinate space (or the current partition,
+// once wrapped in a PartitionedForStmt) with strategy, which must apply.
+LIR::Stmt lower_loop(const ForAll &forall, const IndexStmt &stmt, const FormatMap &formats, const LoweringStrategy strategy,
+                     const BranchProfiling &profiling) {
+    switch (strategy) {
+    case LoweringStrategy::Merge:
+        break;
+    case LoweringStrategy::KWayMerge: {
+        std::vector<LIR::ArrayLevel> operands;
+        const bool applies = get_kway_operands(stmt, formats, operands);
+        assert(applies && forall.body.as<ArrayAssignment>());
+        return lower_kway(*forall.body.as<ArrayAssignment>(), operands, formats);
+    }
+    case LoweringStrategy::Scatter: {
+        auto assign_stmt = forall.body.as<ArrayAssignment>();
+        std::vector<Expr> terms;
+        const bool applies = assign_stmt && get_scatter_terms(*assign_stmt, gather_iterator_set(stmt, formats), formats, terms);
+        assert(applies);
+        return lower_scatter(assign_stmt->lhs, terms, formats, forall.schedule, profiling);
+    }
+    }
+    return lower_merge(stmt, formats, false, forall.schedule, profiling);
+}
+
+// Wrap body, the lowered loop of stmt, in a loop over partitions of its
+// coordinate space.
+LIR::Stmt lower_partitioned(const IndexStmt &stmt, const FormatMap &formats, const LIR::Stmt &body,
+                            const LIR::Partitioning partitioning, const uint64_t grain,
+                            const std::string &position_operand, const bool parallel) {
+    const LIR::IteratorSet arrays = gather_iterator_set(stmt, formats);
+    const LIR::ArrayLevel &out = arrays.iterators.front();
+    // Partitions write disjoint coordinate ranges of a dense output, so they
+    // need no synchronization.
+    assert(out.format == Format::Dense);
+
+    std::vector<LIR::ArrayLevel> compressed;
+    std::copy_if(arrays.iterators.cbegin(), arrays.iterators.cend(), std::back_inserter(compressed),
+                 [](const LIR::ArrayLevel &a) { return a.format == Format::Compressed; });
+
+    return LIR::PartitionedForStmt::make(out, LIR::IteratorSet{compressed}, body, partitioning, grain, position_operand, parallel);
+}
+
+// Honor the ForAll's Schedule around body, the lowered loop of stmt.
+LIR::Stmt lower_scheduled(const ForAll &forall, const IndexStmt &stmt, const FormatMap &formats, const LIR::Stmt &body) {
+    const Schedule &schedule = forall.schedule;
+    if (schedule.split_factor == 0 && schedule.parallel.empty()) {
+        return body;
+    }
+
+    // The outer loop of a split (or the whole loop, when parallelized
+    // unsplit) runs over partitions; the inner loop is body.
+    const LIR::Partitioning partitioning = schedule.position_operand.empty() ? LIR::Partitioning::Coordinates
+                                                                             : LIR::Partitioning::Nonzeros;
+    return lower_partitioned(stmt, formats, body, partitioning, schedule.split_factor,
+                             schedule.position_operand, !schedule.parallel.empty());
+}
+
+}  // namespace
+
+std::vector<LoweringStrategy> lowering_strategies(const IndexStmt &stmt, const FormatMap &formats) {
+    auto forall = stmt.as<ForAll>();
+    assert(forall != nullptr);
+    auto assign_stmt = forall->body.as<ArrayAssignment>();
+    if (!assign_stmt) {
+        return {LoweringStrategy::Merge};
+    }
+    std::vector<LoweringStrategy> strategies;
+    std::vector<LIR::ArrayLevel> operands;
+    const bool kway = get_kway_operands(stmt, formats, operands) && !operands.empty();
+    if (!kway || operands.size() <= merge_max_compressed) {
+        strategies.push_back(LoweringStrategy::Merge);
+    }
+    if (kway) {
+        strategies.push_back(LoweringStrategy::KWayMerge);
+    }
+    std::vector<Expr> terms;
+    if (get_scatter_terms(*assign_stmt, gather_iterator_set(stmt, formats), formats, terms)) {
+        strategies.push_back(LoweringStrategy::Scatter);
+    }
+    return strategies;
+}
+
+LIR::Stmt lower(const IndexStmt &stmt, const FormatMap &formats, const LoweringStrategy strategy) {
+    auto forall = stmt.as<ForAll>();
+    assert(forall != nullptr);
+    return lower_scheduled(*forall, stmt, formats, lower_loop(*forall, stmt, formats, strategy, BranchProfiling{}));
+}
+
+LIR::Stmt lower(const IndexStmt &stmt, const FormatMap &formats) {
+    auto forall = stmt.as<ForAll>();
+    assert(forall != nullptr);
+    return lower(stmt, formats, default_strategy(*forall, stmt, formats));
+}
+
+LoweringStrategy choose_strategy(const IndexStmt &stmt, const FormatMap &formats, const OperandStatsMap &stats) {
+    const std::vector<LoweringStrategy> strategies = lowering_strategies(stmt, formats);
+    LoweringStrategy best = strategies.front();
+    double best_cost = estimate_cost(lower(stmt, formats, best), stats).total();
+    for (auto strategy = strategies.cbegin() + 1; strategy != strategies.cend(); strategy++) {
+        const double cost = estimate_cost(lower(stmt, formats, *strategy), stats).total();
+        if (cost < best_cost) {
+            best = *strategy;
+            best_cost = cost;
+        }
+    }
+    return best;
+}
+
+LIR::Stmt lower(const IndexStmt &stmt, const FormatMap &formats, const OperandStatsMap &stats) {
+    return lower(stmt, formats, choose_strategy(stmt, formats, stats));
+}
+
+std::vector<KernelVariant> lower_variants(const IndexStmt &stmt, const FormatMap &formats) {
+    auto forall = stmt.as<ForAll>();
+    assert(forall != nullptr);
+    std::vector<KernelVariant> variants = {{KernelVariantKind::Merge, "", lower(stmt, formats)}};
+
+    auto assign_stmt = forall->body.as<ArrayAssignment>();
+    std::vector<LIR::ArrayLevel> operands;
+    if (!assign_stmt || !get_kway_operands(stmt, formats, operands) || operands.empty() ||
+        LIR::access_to_array_level(assign_stmt->lhs, formats).format != Format::Dense) {
+        return variants;
+    }
+
+    variants.push_back({KernelVariantKind::DenseLocate, "",
+                        lower_scheduled(*forall, stmt, formats, lower_dense_locate(*assign_stmt, operands, formats))});
+    if (operands.size() >= 2 && !contains_add(assign_stmt->rhs)) {
+        for (size_t lead = 0; lead < operands.size(); lead++) {
+            variants.push_back({KernelVariantKind::Gallop, operands[lead].name,
+                                lower_scheduled(*forall, stmt, formats, lower_gallop(forall->body, operands, lead, formats))});
+        }
+    }
+    return variants;
+}
+
+LIR::Stmt lower_instrumented(const IndexStmt &stmt, const FormatMap &formats, std::vector<std::string> &counter_keys) {
+    auto forall = stmt.as<ForAll>();
+    assert(forall != nullptr);
+    BranchProfiling profiling;
+    profiling.counter_keys = &counter_keys;
+    return lower_scheduled(*forall, stmt, formats,
+                           lower_loop(*forall, stmt, formats, default_strategy(*forall, stmt, formats), profiling));
+}
+
+LIR::Stmt lower(const IndexStmt &stmt, const FormatMap &formats, const BranchProfile &profile) {
+    auto forall = stmt.as<ForAll>();
+    assert(forall != nullptr);
+    BranchProfiling profiling;
+    profiling.profile = &profile;
+    return lower_scheduled(*forall, stmt, formats,
+                           lower_loop(*forall, stmt, formats, default_strategy(*forall, stmt, formats), profiling));
+}
+
+LIR::Stmt lower_parallel(const IndexStmt &stmt, const FormatMap &formats,
+                         const LIR::Partitioning partitioning, const uint64_t grain) {
+    auto forall = stmt.as<ForAll>();
+    assert(forall != nullptr);
+    // Scheduled statements already say how to partition themselves.
+    assert(forall->schedule.split_factor == 0 && forall->schedule.parallel.empty());
+
+    // Coordinate partitions are one per thread, whatever the grain.
+    const uint64_t part_grain = partitioning == LIR::Partitioning::Nonzeros ? grain : 0;
+    return lower_partitioned(stmt, formats, lower(stmt, formats), partitioning, part_grain, "", true);
+}
@@ -0,0 +1,44 @@
+#include "Profile.h"
+
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+std::string join_names(const std::vector<LIR::ArrayLevel> &iterators) {
+    std::string joined;
+    for (const auto &iter : iterators) {
+        joined += (joined.empty() ? "" : ",") + iter.name.str();
+    }
+    return joined;
+}
+
+}  // namespace
+
+uint64_t BranchProfile::count(const std::string &key) const {
+    auto found = counts.find(key);
+    return found != counts.end() ? found->second : 0;
+}
+
+std::string loop_profile_key(const std::vector<LIR::ArrayLevel> &iterators) {
+    return join_names(iterators);
+}
+
+std::string case_profile_key(const std::vector<LIR::ArrayLevel> &loop_iterators,
+                             const std::vector<LIR::ArrayLevel> &case_iterators) {
+    return join_names(loop_iterators) + "/" + join_names(case_iterators);
+}
+
+BranchProfile read_branch_profile(const std::string &filename) {
+    BranchProfile profile;
+    std::ifstream file(filename);
+    std::string line;
+    while (std::getline(file, line)) {
+        const size_t tab = line.find('\t');
+        if (tab == std::string::npos) {
+            continue;
+        }
+        profile.counts[line.substr(0, tab)] += std::stoull(line.substr(tab + 1));
+    }
+    return profile;
+}
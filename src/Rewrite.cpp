@@ -0,0 +1,161 @@
+#include "Rewrite.h"
+
+#include <algorithm>
+#include <tuple>
+#include <vector>
+
+#include "IRVisitor.h"
+#include "Lattice.h"
+#include "Lower.h"
+
+namespace {
+
+size_t count_operations(const IndexStmt &stmt) {
+    struct CountOperations : public IRVisitor {
+        size_t operations = 0;
+
+        void visit(const Add *node) override {
+            operations++;
+            IRVisitor::visit(node);
+        }
+        void visit(const Mul *node) override {
+            operations++;
+            IRVisitor::visit(node);
+        }
+    };
+    CountOperations counter;
+    stmt.accept(&counter);
+    return counter.operations;
+}
+
+// Operands of the chain of additions (or multiplications) rooted at expr.
+void flatten(const Expr &expr, const bool add, std::vector<Expr> &operands) {
+    if (auto node = expr.as<Add>(); node && add) {
+        flatten(node->a, add, operands);
+        flatten(node->b, add, operands);
+    } else if (auto node = expr.as<Mul>(); node && !add) {
+        flatten(node->a, add, operands);
+        flatten(node->b, add, operands);
+    } else {
+        operands.push_back(expr);
+    }
+}
+
+// The left-deep chain ((o0 op o1) op o2) ...
+Expr build(const std::vector<Expr> &operands, const bool add) {
+    Expr expr = operands.front();
+    for (auto it = operands.cbegin() + 1; it != operands.cend(); it++) {
+        expr = add ? Expr(Add::make(expr, *it)) : Expr(Mul::make(expr, *it));
+    }
+    return expr;
+}
+
+// Name of the array expr reads, or empty if it is not a read.
+std::string read_name(const Expr &expr) {
+    auto read = expr.as<ArrayRead>();
+    return read ? read->access.name : "";
+}
+
+struct Rewriter {
+    const Access &lhs;
+    const FormatMap &formats;
+
+    Rewriter(const Access &lhs, const FormatMap &formats)
+        : lhs(lhs), formats(formats) {}
+
+    // candidate if it is defined and cheaper than current, else current.
+    Expr cheaper(const Expr &current, const Expr &candidate) {
+        if (candidate.defined() && lattice_cost(Assignment(lhs, candidate), formats) < lattice_cost(Assignment(lhs, current), formats)) {
+            return candidate;
+        }
+        return current;
+    }
+
+    // a + b with a factor common to both products taken out, or undefined.
+    Expr factor(const Expr &a, const Expr &b) {
+        std::vector<Expr> factors_a, factors_b;
+        flatten(a, false, factors_a);
+        flatten(b, false, factors_b);
+        if (factors_a.size() < 2 || factors_b.size() < 2) {
+            return Expr();
+        }
+        for (auto fa = factors_a.cbegin(); fa != factors_a.cend(); fa++) {
+            const std::string name = read_name(*fa);
+            auto fb = std::find_if(factors_b.cbegin(), factors_b.cend(),
+                                   [&](const Expr &f) { return !name.empty() && read_name(f) == name; });
+            if (fb == factors_b.cend()) {
+                continue;
+            }
+            const Expr common = *fa;
+            factors_a.erase(fa);
+            factors_b.erase(fb);
+            const Expr sum = Add::make(build(factors_a, false), build(factors_b, false));
+            return Mul::make(common, rewrite(sum));
+        }
+        return Expr();
+    }
+
+    // The chain rooted at expr, with compressed reads first and dense reads last.
+    Expr reassociate(const Expr &expr, const bool add) {
+        std::vector<Expr> operands;
+        flatten(expr, add, operands);
+        if (operands.size() < 3) {
+            return Expr();
+        }
+        auto rank = [&](const Expr &operand) {
+            const std::string name = read_name(operand);
+            if (name.empty()) {
+                return 1;
+            }
+            return formats.at(name)[0] == Format::Compressed ? 0 : 2;
+        };
+        std::stable_sort(operands.begin(), operands.end(),
+                         [&](const Expr &x, const Expr &y) { return rank(x) < rank(y); });
+        return build(operands, add);
+    }
+
+    Expr rewrite(const Expr &expr) {
+        switch (expr.ptr->kind) {
+        case ExprKind::Add: {
+            auto add = expr.as<Add>();
+            const Expr a = rewrite(add->a);
+            const Expr b = rewrite(add->b);
+            Expr result = Add::make(a, b);
+            result = cheaper(result, factor(a, b));
+            return cheaper(result, reassociate(result, true));
+        }
+        case ExprKind::Mul: {
+            auto mul = expr.as<Mul>();
+            Expr result = Mul::make(rewrite(mul->a), rewrite(mul->b));
+            return cheaper(result, reassociate(result, false));
+        }
+        case ExprKind::ArrayRead:
+            break;
+        }
+        return expr;
+    }
+};
+
+}  // namespace
+
+bool LatticeCost::operator<(const LatticeCost &other) const {
+    return std::tie(points, operations) < std::tie(other.points, other.operations);
+}
+
+LatticeCost lattice_cost(const Assignment &assignment, const FormatMap &formats) {
+    const IndexStmt stmt = lower(assignment);
+    auto forall = stmt.as<ForAll>();
+    const MergeLattice lattice = MergeLattice::make(forall->sexpr, forall->body, formats);
+
+    LatticeCost cost;
+    for (const auto &[sexpr, point] : lattice.node_map) {
+        cost.points++;
+        cost.operations += count_operations(point->body);
+    }
+    return cost;
+}
+
+Assignment rewrite(const Assignment &assignment, const FormatMap &formats) {
+    Rewriter rewriter(assignment.access, formats);
+    return Assignment(assignment.access, rewriter.rewrite(assignment.rhs));
+}
@@ -1,5 +1,28 @@
 #include "SetExpr.h"
 #include "IRVisitor.h"
+#include "Intern.h"
+
+namespace {
+
+InternTable<SetExprNode> &set_expr_table() {
+    static InternTable<SetExprNode> table;
+    return table;
+}
+
+uint64_t id_of(const SetExpr &sexpr) {
+    return sexpr.defined() ? sexpr.ptr->id : 0;
+}
+
+template<typename T>
+std::shared_ptr<const T> make_binop(const SetExprKind kind, SetExpr a, SetExpr b) {
+    return set_expr_table().get<T>(InternKey{int(kind), "", id_of(a), id_of(b)}, [&] {
+        auto node = std::make_shared<T>(a, b);
+        node->kind = kind;
+        return node;
+    });
+}
+
+}  // namespace
 
 void SetExpr::accept(IRVisitor *v) const {
     ptr->accept(v);
@@ -18,15 +41,16 @@ void ArrayDim::accept(IRVisitor *v) const {
 }
 
 const std::shared_ptr<const ArrayDim> ArrayDim::make(const Access &_access) {
-    auto node = std::make_shared<ArrayDim>(_access);
-    node->kind = SetExprKind::ArrayDim;
-    return node;
+    const InternKey key{int(SetExprKind::ArrayDim), intern_name(_access)};
+    return set_expr_table().get<ArrayDim>(key, [&] {
+        auto node = std::make_shared<ArrayDim>(_access);
+        node->kind = SetExprKind::ArrayDim;
+        return node;
+    });
 }
 
 const std::shared_ptr<const Union> Union::make(SetExpr _a, SetExpr _b) {
-    auto node = std::make_shared<Union>(_a, _b);
-    node->kind = SetExprKind::Union;
-    return node;
+    return make_binop<Union>(SetExprKind::Union, _a, _b);
 }
 
 void Union::accept(IRVisitor *v) const {
@@ -34,9 +58,7 @@ void Union::accept(IRVisitor *v) const {
 }
 
 const std::shared_ptr<const Intersection> Intersection::make(SetExpr _a, SetExpr _b) {
-    auto node = std::make_shared<Intersection>(_a, _b);
-    node->kind = SetExprKind::Intersection;
-    return node;
+    return make_binop<Intersection>(SetExprKind::Intersection, _a, _b);
 }
 
 void Intersection::accept(IRVisitor *v) const {
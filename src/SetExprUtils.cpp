@@ -3,44 +3,71 @@
 #include "SetExprUtils.h"
 #include "Format.h"
 
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
 struct IRVisitor;
 
 
 bool SetComparator::operator()(const SetExpr &lhs, const SetExpr &rhs) const {
-    if (!lhs.defined() && !rhs.defined()) return false;
-    if (!lhs.defined()) return true;
-    if (!rhs.defined()) return false;
-
-    if (lhs.ptr->kind != rhs.ptr->kind)
-        return lhs.ptr->kind < rhs.ptr->kind;
-
-    auto binop = [&](auto const& l, auto const& r) -> bool {
-        if ((*this)(l->a, r->a)) return true;
-        if ((*this)(r->a, l->a)) return false;
-        if ((*this)(l->b, r->b)) return true;
-        if ((*this)(r->b, l->b)) return false;
-        return false;
-    };
+    // Interned nodes are equal iff they are the same node.
+    const uint64_t l = lhs.defined() ? lhs.ptr->id : 0;
+    const uint64_t r = rhs.defined() ? rhs.ptr->id : 0;
+    return l < r;
+}
+
+
+namespace {
+
+struct Canonicalize : public IRVisitor {
+    SetExpr sexpr;
 
-    if (lhs.ptr->kind == SetExprKind::ArrayDim) {
-        auto l = std::dynamic_pointer_cast<const ArrayDim>(lhs.ptr);
-        auto r = std::dynamic_pointer_cast<const ArrayDim>(rhs.ptr);
-        assert(l && r);
-        return l->access.name < r->access.name;
-    } else if (lhs.ptr->kind == SetExprKind::Union) {
-        auto l = std::dynamic_pointer_cast<const Union>(lhs.ptr);
-        auto r = std::dynamic_pointer_cast<const Union>(rhs.ptr);
-        assert(l && r);
-        return binop(l, r);
-    } else if (lhs.ptr->kind == SetExprKind::Intersection) {
-        auto l = std::dynamic_pointer_cast<const Intersection>(lhs.ptr);
-        auto r = std::dynamic_pointer_cast<const Intersection>(rhs.ptr);
-        assert(l && r);
-        return binop(l, r);
+    // Canonical operands of the chain of unions (or intersections) at node.
+    template<typename T>
+    void flatten(const T *node, std::vector<SetExpr> &operands) {
+        for (const SetExpr &operand : {node->a, node->b}) {
+            if (auto same = operand.as<T>()) {
+                flatten(same.get(), operands);
+            } else {
+                operand.accept(this);
+                operands.push_back(sexpr);
+            }
+        }
+    }
+
+    template<typename T>
+    void visit_nary(const T *node) {
+        std::vector<SetExpr> operands;
+        flatten(node, operands);
+        SetComparator less;
+        std::sort(operands.begin(), operands.end(), less);
+        operands.erase(std::unique(operands.begin(), operands.end(),
+                                   [](const SetExpr &a, const SetExpr &b) { return a == b; }),
+                       operands.end());
+        sexpr = operands.front();
+        for (auto it = operands.cbegin() + 1; it != operands.cend(); it++) {
+            sexpr = T::make(sexpr, *it);
+        }
     }
 
-    assert(false && "Unreachable");
-    return false;
+    void visit(const ArrayDim *arrayDim) override {
+        sexpr = ArrayDim::make(arrayDim->access);
+    }
+    void visit(const Union *unionNode) override {
+        visit_nary(unionNode);
+    }
+    void visit(const Intersection *intersectionNode) override {
+        visit_nary(intersectionNode);
+    }
+};
+
+}  // namespace
+
+SetExpr canonicalize(const SetExpr &sexpr) {
+    Canonicalize canonicalizer;
+    sexpr.accept(&canonicalizer);
+    return canonicalizer.sexpr;
 }
 
 
@@ -123,9 +150,9 @@ SetExpr get_simplified_set_expr(const SetExpr &sexpr, const LIR::ArrayLevel &rem
     return std::move(simplifier.sexpr);
 }
 
-std::set<SetExpr, SetComparator> get_iterators(const SetExpr &sexpr, const FormatMap &formats) {
+std::unordered_set<SetExpr, SetExprHash> get_iterators(const SetExpr &sexpr, const FormatMap &formats) {
     struct CollectIterators : public IRVisitor {
-        std::set<SetExpr, SetComparator> iterators;
+        std::unordered_set<SetExpr, SetExprHash> iterators;
         const FormatMap &formats;
 
         CollectIterators(const FormatMap &formats) : formats(formats) {}
@@ -146,7 +173,7 @@ std::pair<std::vector<LIR::ArrayLevel>, std::vector<LIR::ArrayLevel>> split_iter
     std::vector<LIR::ArrayLevel> locators;
 
     struct GetSparseMap : public IRVisitor {
-        std::map<SetExpr, bool, SetComparator> sparse_map;
+        std::unordered_map<SetExpr, bool, SetExprHash> sparse_map;
         const FormatMap &formats;
 
         GetSparseMap(const FormatMap &formats) : formats(formats) {}
@@ -176,11 +203,11 @@ std::pair<std::vector<LIR::ArrayLevel>, std::vector<LIR::ArrayLevel>> split_iter
    struct IteratorLocator : public IRVisitor {
        std::vector<LIR::ArrayLevel> iterators;
        std::vector<LIR::ArrayLevel> locators;
-       std::map<SetExpr, bool, SetComparator>& sparse_map;
+       std::unordered_map<SetExpr, bool, SetExprHash>& sparse_map;
        const FormatMap &formats;
        bool is_under_intersect = false;
        bool is_under_dense_union = false;
-       IteratorLocator(std::map<SetExpr, bool, SetComparator>& sparse_map, const FormatMap &formats)
+       IteratorLocator(std::unordered_map<SetExpr, bool, SetExprHash>& sparse_map, const FormatMap &formats)
            : sparse_map(sparse_map), formats(formats) {}
        virtual void visit(const ArrayDim *arrayDim) override {
            auto node = ArrayDim::make(arrayDim->access);
@@ -219,19 +246,44 @@ std::pair<std::vector<LIR::ArrayLevel>, std::vector<LIR::ArrayLevel>> split_iter
    IteratorLocator locator(sparseMap, formats);
    sexpr.accept(&locator);
 
-   return {locator.iterators, locator.locators};
+   // An operand that appears several times (e.g. in a fused set expression)
+   // is iterated, or located, once. Iterating it takes precedence.
+   std::set<std::string> seen;
+   for (const auto &iterator : locator.iterators) {
+       if (seen.insert(iterator.name).second) {
+           iterators.push_back(iterator);
+       }
+   }
+   for (const auto &level : locator.locators) {
+       if (seen.insert(level.name).second) {
+           locators.push_back(level);
+       }
+   }
+   return {iterators, locators};
 }
 
 
 IndexStmt get_simplified_index_stmt(const IndexStmt &stmt, const SetExpr &sexpr, const FormatMap &formats) {
-    auto assign_stmt = std::dynamic_pointer_cast<const ArrayAssignment>(stmt.ptr);
+    // Keep the assignments of a Multi that are still defined over sexpr.
+    if (auto multi = stmt.as<Multi>()) {
+        std::vector<IndexStmt> stmts;
+        for (const auto &s : multi->stmts) {
+            IndexStmt simplified = get_simplified_index_stmt(s, sexpr, formats);
+            if (simplified.as<ArrayAssignment>()->rhs.defined()) {
+                stmts.push_back(simplified);
+            }
+        }
+        return Multi::make(stmts);
+    }
+
+    auto assign_stmt = stmt.as<ArrayAssignment>();
     assert(assign_stmt != nullptr);
 
     struct SimplifyBody : public IRVisitor {
         Expr simplified_expr;
-        const std::set<SetExpr, SetComparator> &iterators;
+        const std::unordered_set<SetExpr, SetExprHash> &iterators;
 
-        SimplifyBody(const std::set<SetExpr, SetComparator> &iterators)
+        SimplifyBody(const std::unordered_set<SetExpr, SetExprHash> &iterators)
             : iterators(iterators) {}
 
         virtual void visit(const ArrayRead * arrayread) {
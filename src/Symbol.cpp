@@ -0,0 +1,26 @@
+#include "Symbol.h"
+
+#include <mutex>
+#include <unordered_set>
+
+namespace {
+
+// Every symbol's string. Symbols are never freed; there is one per distinct
+// name, so this stays small.
+const std::string *intern(const std::string &name) {
+    static std::mutex mutex;
+    static std::unordered_set<std::string> names;
+    std::lock_guard<std::mutex> lock(mutex);
+    return &*names.insert(name).first;
+}
+
+}  // namespace
+
+Symbol::Symbol()
+    : name(intern("")) {}
+
+Symbol::Symbol(const std::string &_name)
+    : name(intern(_name)) {}
+
+Symbol::Symbol(const char *_name)
+    : name(intern(_name)) {}
@@ -0,0 +1,40 @@
+#include "TaskGraph.h"
+
+#include <algorithm>
+
+#include "GatherIteratorSet.h"
+#include "Lower.h"
+
+TaskGraph make_task_graph(const std::vector<Assignment> &assignments, const FormatMap &formats) {
+    TaskGraph graph;
+    for (const auto &assignment : assignments) {
+        // The first iterator is the output, the rest are the operands.
+        const LIR::IteratorSet arrays = gather_iterator_set(lower(assignment), formats);
+        std::vector<std::string> reads;
+        for (auto it = arrays.iterators.cbegin() + 1; it != arrays.iterators.cend(); it++) {
+            if (std::find(reads.cbegin(), reads.cend(), it->name) == reads.cend()) {
+                reads.push_back(it->name);
+            }
+        }
+        graph.assignments.push_back(assignment);
+        graph.reads.push_back(reads);
+        graph.writes.push_back(arrays.iterators.front().name);
+    }
+
+    auto reads_array = [&](const size_t t, const std::string &name) {
+        return std::find(graph.reads[t].cbegin(), graph.reads[t].cend(), name) != graph.reads[t].cend();
+    };
+    for (size_t t = 0; t < assignments.size(); t++) {
+        std::vector<size_t> dependencies;
+        for (size_t earlier = 0; earlier < t; earlier++) {
+            const bool read_after_write = reads_array(t, graph.writes[earlier]);
+            const bool write_after_read = reads_array(earlier, graph.writes[t]);
+            const bool write_after_write = graph.writes[earlier] == graph.writes[t];
+            if (read_after_write || write_after_read || write_after_write) {
+                dependencies.push_back(earlier);
+            }
+        }
+        graph.dependencies.push_back(dependencies);
+    }
+    return graph;
+}
@@ -0,0 +1,28 @@
+#include <cassert>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+
+#include "project.h"
+
+
+
+int main(const int argc, const char** argv) {
+    Index i{"i"};
+    Array A{"A"}, B{"B"}, C{"C"}, D{"D"};
+
+    Assignment a = (A(i) = (B(i) + C(i)) * D(i));
+    FormatMap formats = {
+        {"A", {Format::Dense}},
+        {"B", {Format::Compressed}},
+        {"C", {Format::Dense}},
+        {"D", {Format::Compressed}},
+    };
+
+    IndexStmt stmt = lower(a);
+    LIR::Stmt lstmt = lower_parallel(stmt, formats);
+    compile_and_test(lstmt, {"A", "B", "C", "D"}, "tests/test10_runner.cpp");
+
+    return 0;
+}
+
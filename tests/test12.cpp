@@ -0,0 +1,31 @@
+#include <cassert>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+
+#include "project.h"
+
+
+
+int main(const int argc, const char** argv) {
+    Index i{"i"}, i0{"i0"}, i1{"i1"};
+    Array A{"A"}, B{"B"}, C{"C"}, D{"D"};
+
+    Assignment a = (A(i) = B(i) * C(i) + D(i));
+    FormatMap formats = {
+        {"A", {Format::Dense}},
+        {"B", {Format::Compressed}},
+        {"C", {Format::Dense}},
+        {"D", {Format::Compressed}},
+    };
+
+    IndexStmt stmt = lower(a)
+        .split_pos(i, D(i), i0, i1, 16)
+        .parallelize(i0)
+        .vectorize(i1, 4)
+        .unroll(i1, 2);
+    LIR::Stmt lstmt = lower(stmt, formats);
+    compile_and_test(lstmt, {"A", "B", "C", "D"}, "tests/test12_runner.cpp");
+
+    return 0;
+}
@@ -0,0 +1,29 @@
+#include <cassert>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+
+#include "project.h"
+
+
+
+int main(const int argc, const char** argv) {
+    Index i{"i"}, i0{"i0"}, i1{"i1"};
+    Array A{"A"}, B{"B"}, C{"C"}, D{"D"};
+
+    Assignment a = (A(i) = B(i) * C(i) + D(i));
+    FormatMap formats = {
+        {"A", {Format::Dense}},
+        {"B", {Format::Dense}},
+        {"C", {Format::Dense}},
+        {"D", {Format::Dense}},
+    };
+
+    IndexStmt stmt = lower(a)
+        .split(i, i0, i1, 64)
+        .vectorize(i1, 8);
+    LIR::Stmt lstmt = lower(stmt, formats);
+    compile_and_test(lstmt, {"A", "B", "C", "D"}, "tests/test13_runner.cpp");
+
+    return 0;
+}
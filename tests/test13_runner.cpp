@@ -0,0 +1,38 @@
+#include <cstdint>
+#include <iostream>
+#include <cstdlib>
+
+#include "utils.h"
+
+
+void reference(array &A, const array &B, const array &C, const array &D) {
+  for (uint32_t i = 0; i < A.shape[0]; i++) {
+    A.values[i] = B.values[i] * C.values[i] + D.values[i];
+  }
+}
+
+
+void run_test(const int N) {
+    array A_kernel = empty_dense_array(N);
+    array A_ref = empty_dense_array(N);
+    array B = random_dense_array(N);
+    array C = random_dense_array(N);
+    array D = random_dense_array(N);
+
+    kernel(A_kernel, B, C, D);
+    reference(A_ref, B, C, D);
+
+    assert_dense_array_match(A_kernel, A_ref, N);
+
+    std::cout << "Success\n";
+}
+
+int main(const int argc, const char** argv) {
+    srand(0);
+    // Extents below, at and above the block size.
+    run_test(3);
+    run_test(64);
+    run_test(100);
+    run_test(1000);
+    run_test(4096);
+}
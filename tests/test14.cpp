@@ -0,0 +1,26 @@
+#include <cassert>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+
+#include "project.h"
+
+
+
+int main(const int argc, const char** argv) {
+    Index i{"i"};
+    Array A{"A"}, B{"B"}, C{"C"};
+
+    Assignment a = (A(i) = B(i) * C(i));
+    FormatMap formats = {
+        {"A", {Format::Dense}},
+        {"B", {Format::Compressed}},
+        {"C", {Format::Dense}},
+    };
+
+    IndexStmt stmt = lower(a);
+    LIR::Stmt lstmt = lower_parallel(stmt, formats);
+    compile_and_test(lstmt, {"A", "B", "C"}, "tests/test14_runner.cpp");
+
+    return 0;
+}
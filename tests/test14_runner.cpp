@@ -0,0 +1,61 @@
+#include <cstdint>
+#include <iostream>
+#include <cstdlib>
+
+#include "runtime/numa.h"
+#include "utils.h"
+
+
+void reference(array &A, const array &B, const array &C) {
+  uint32_t iB = B.pos[0];
+  uint32_t pB_end = B.pos[1];
+
+  while (iB < pB_end) {
+    uint32_t i = B.crd[iB];
+    A.values[i] = B.values[iB] * C.values[i];
+    iB++;
+  }
+}
+
+
+void run_test(const int N, const double sparsity) {
+    array A_kernel = empty_dense_array(N);
+    array A_ref = empty_dense_array(N);
+    array B = random_sparse_array(N, sparsity);
+    array C = random_dense_array(N);
+
+    // Place every partition on the node of the thread that computes it.
+    const std::vector<uint64_t> bounds = numa_coordinate_bounds(N, kernel_thread_pool().size());
+    delete[] A_kernel.values;
+    A_kernel.values = numa_alloc_values(N);
+    assert(A_kernel.values != nullptr);
+    const bool placed = numa_place(B, true, bounds) && numa_place(C, false, bounds);
+    assert(placed);
+
+    kernel(A_kernel, B, C);
+    reference(A_ref, B, C);
+
+    assert_dense_array_match(A_kernel, A_ref, N);
+
+    // Every byte read is accounted for, and on one node none of it is remote.
+    numa_traffic traffic = numa_estimate_traffic(B, true, bounds);
+    traffic += numa_estimate_traffic(C, false, bounds);
+    const uint64_t count = (N * sparsity);
+    assert(traffic.local_bytes + traffic.remote_bytes == count * (sizeof(uint64_t) + sizeof(float)) + N * sizeof(float));
+    assert(kernel_numa_topology().nodes() > 1 || traffic.remote_bytes == 0);
+
+    numa_free_values(A_kernel.values, N);
+    std::cout << "Success\n";
+}
+
+int main(const int argc, const char** argv) {
+    setenv("KERNEL_NUM_THREADS", "4", 1);
+    const bool pinned = numa_pin_kernel_threads();
+    assert(pinned);
+    srand(0);
+    run_test(3, 0.5);
+    run_test(10, 0.1);
+    run_test(10, 0.5);
+    run_test(1000, 0.3);
+    run_test(100000, 0.9);
+}
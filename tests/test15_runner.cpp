@@ -0,0 +1,100 @@
+#include <cstdint>
+#include <iostream>
+#include <cstdlib>
+
+#include "utils.h"
+
+
+void reference(array &A, const array &B, const array &C, const array &D) {
+  uint32_t iB = B.pos[0];
+  uint32_t pB1_end = B.pos[1];
+  uint32_t iD = D.pos[0];
+  uint32_t pD1_end = D.pos[1];
+
+  while (iB < pB1_end && iD < pD1_end) {
+    uint32_t iB0 = B.crd[iB];
+    uint32_t iD0 = D.crd[iD];
+    uint32_t i = min(iB0, iD0);
+    if (iB0 == i && iD0 == i) {
+      A.values[i] = B.values[iB] * C.values[i] + D.values[iD];
+    }
+    else if (iB0 == i) {
+      A.values[i] = B.values[iB] * C.values[i];
+    }
+    else if (iD0 == i) {
+      A.values[i] = D.values[iD];
+    }
+    iB += (uint32_t)(iB0 == i);
+    iD += (uint32_t)(iD0 == i);
+  }
+  while (iB < pB1_end) {
+    uint32_t i = B.crd[iB];
+    A.values[i] = B.values[iB] * C.values[i];
+    iB++;
+  }
+  while (iD < pD1_end) {
+    uint32_t i = D.crd[iD];
+    A.values[i] = D.values[iD];
+    iD++;
+  }
+}
+
+
+// Stack K random vectors of extent N into one batch (see runtime/batch.h).
+array random_sparse_batch(const int K, const int N, const double sparsity) {
+    const int count = (N * sparsity);
+    array A;
+    A.shape = new uint64_t[1]();
+    A.shape[0] = N;
+    A.pos = new uint64_t[K + 1]();
+    A.crd = new uint64_t[K * count]();
+    A.values = new float[K * count]();
+    for (int k = 0; k < K; k++) {
+        array segment = random_sparse_array(N, sparsity);
+        A.pos[k + 1] = A.pos[k] + count;
+        std::copy(segment.crd, segment.crd + count, A.crd + A.pos[k]);
+        std::copy(segment.values, segment.values + count, A.values + A.pos[k]);
+    }
+    return A;
+}
+
+array random_dense_batch(const int K, const int N) {
+    array A = random_dense_array(K * N);
+    A.shape[0] = N;
+    return A;
+}
+
+array empty_dense_batch(const int K, const int N) {
+    array A = empty_dense_array(K * N);
+    A.shape[0] = N;
+    return A;
+}
+
+
+void run_test(const int K, const int N, const double sparsity) {
+    array A_kernel = empty_dense_batch(K, N);
+    array A_ref = empty_dense_batch(K, N);
+    array B = random_sparse_batch(K, N, sparsity);
+    array C = random_dense_batch(K, N);
+    array D = random_sparse_batch(K, N, sparsity);
+
+    kernel_batch(K, A_kernel, B, C, D);
+    for (int k = 0; k < K; k++) {
+        array A_k = batch_segment_dense(A_ref, k);
+        reference(A_k, batch_segment_compressed(B, k), batch_segment_dense(C, k), batch_segment_compressed(D, k));
+    }
+
+    assert_dense_array_match(A_kernel, A_ref, K * N);
+
+    std::cout << "Success\n";
+}
+
+int main(const int argc, const char** argv) {
+    setenv("KERNEL_NUM_THREADS", "4", 1);
+    srand(0);
+    run_test(1, 3, 0.5);
+    run_test(10, 10, 0.1);
+    run_test(64, 10, 0.5);
+    run_test(1000, 50, 0.3);
+    run_test(5000, 20, 0.9);
+}
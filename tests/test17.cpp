@@ -0,0 +1,40 @@
+#include <cassert>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+
+#include "project.h"
+
+
+
+int main(const int argc, const char** argv) {
+    Index i{"i"};
+    Array A{"A"}, B{"B"}, C{"C"}, D{"D"}, E{"E"}, F{"F"};
+
+    std::vector<Assignment> assignments = {
+        (A(i) = B(i) * C(i)),
+        (D(i) = B(i) + E(i)),
+        (F(i) = A(i) + D(i)),
+        (C(i) = E(i) * D(i)),
+    };
+    FormatMap formats = {
+        {"A", {Format::Dense}},
+        {"B", {Format::Compressed}},
+        {"C", {Format::Dense}},
+        {"D", {Format::Dense}},
+        {"E", {Format::Compressed}},
+        {"F", {Format::Dense}},
+    };
+
+    TaskGraph graph = make_task_graph(assignments, formats);
+    // The first two are independent. The third reads both of their outputs,
+    // and the last overwrites an input of the first and reads the second's output.
+    assert(graph.dependencies[0].empty());
+    assert(graph.dependencies[1].empty());
+    assert((graph.dependencies[2] == std::vector<size_t>{0, 1}));
+    assert((graph.dependencies[3] == std::vector<size_t>{0, 1}));
+
+    compile_and_test(graph, formats, "tests/test17_runner.cpp");
+
+    return 0;
+}
@@ -0,0 +1,64 @@
+#include <cstdint>
+#include <iostream>
+#include <cstdlib>
+
+#include "utils.h"
+
+
+// Scatter a compressed array into a dense one of extent N.
+array densify(const array &B, const int N) {
+    array dense = empty_dense_array(N);
+    for (uint64_t p = B.pos[0]; p < B.pos[1]; p++) {
+        dense.values[B.crd[p]] = B.values[p];
+    }
+    return dense;
+}
+
+void reference(array &A, const array &B, array &C, array &D, const array &E, array &F, const int N) {
+  const array B_dense = densify(B, N);
+  const array E_dense = densify(E, N);
+  for (uint64_t p = B.pos[0]; p < B.pos[1]; p++) {
+    A.values[B.crd[p]] = B.values[p] * C.values[B.crd[p]];
+  }
+  for (int i = 0; i < N; i++) {
+    D.values[i] = B_dense.values[i] + E_dense.values[i];
+  }
+  for (int i = 0; i < N; i++) {
+    F.values[i] = A.values[i] + D.values[i];
+  }
+  for (uint64_t p = E.pos[0]; p < E.pos[1]; p++) {
+    C.values[E.crd[p]] = E.values[p] * D.values[E.crd[p]];
+  }
+}
+
+
+void run_test(const int N, const double sparsity) {
+    array B = random_sparse_array(N, sparsity);
+    array E = random_sparse_array(N, sparsity);
+    array C_kernel = random_dense_array(N);
+    array C_ref = empty_dense_array(N);
+    std::copy(C_kernel.values, C_kernel.values + N, C_ref.values);
+    array A_kernel = empty_dense_array(N), A_ref = empty_dense_array(N);
+    array D_kernel = empty_dense_array(N), D_ref = empty_dense_array(N);
+    array F_kernel = empty_dense_array(N), F_ref = empty_dense_array(N);
+
+    kernel_graph(A_kernel, B, C_kernel, D_kernel, E, F_kernel);
+    reference(A_ref, B, C_ref, D_ref, E, F_ref, N);
+
+    assert_dense_array_match(A_kernel, A_ref, N);
+    assert_dense_array_match(C_kernel, C_ref, N);
+    assert_dense_array_match(D_kernel, D_ref, N);
+    assert_dense_array_match(F_kernel, F_ref, N);
+
+    std::cout << "Success\n";
+}
+
+int main(const int argc, const char** argv) {
+    setenv("KERNEL_NUM_THREADS", "4", 1);
+    srand(0);
+    run_test(3, 0.5);
+    run_test(10, 0.1);
+    run_test(10, 0.5);
+    run_test(1000, 0.3);
+    run_test(1000, 0.9);
+}
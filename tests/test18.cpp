@@ -0,0 +1,27 @@
+#include <cassert>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+
+#include "project.h"
+
+
+
+int main(const int argc, const char** argv) {
+    Index i{"i"};
+    Array A{"A"}, B{"B"}, C{"C"}, D{"D"};
+
+    Assignment a = (A(i) = (B(i) + C(i)) * D(i));
+    FormatMap formats = {
+        {"A", {Format::Dense}},
+        {"B", {Format::Compressed}},
+        {"C", {Format::Compressed}},
+        {"D", {Format::Dense}},
+    };
+
+    IndexStmt stmt = lower(a).interleave(i, 4);
+    LIR::Stmt lstmt = lower(stmt, formats);
+    compile_and_test(lstmt, {"A", "B", "C", "D"}, "tests/test18_runner.cpp");
+
+    return 0;
+}
@@ -0,0 +1,89 @@
+#include <cstdint>
+#include <iostream>
+#include <cstdlib>
+
+#include "utils.h"
+
+
+void reference(array &A, const array &B, const array &C, const array &D) {
+  uint32_t iB = B.pos[0];
+  uint32_t pB_end = B.pos[1];
+  uint32_t iC = C.pos[0];
+  uint32_t pC_end = C.pos[1];
+
+  while (iB < pB_end && iC < pC_end) {
+    uint32_t iB0 = B.crd[iB];
+    uint32_t iC0 = C.crd[iC];
+    uint32_t i = min(iB0, iC0);
+    if (iB0 == i && iC0 == i) {
+      A.values[i] = (B.values[iB] + C.values[iC]) * D.values[i];
+    }
+    else if (iB0 == i) {
+      A.values[i] = B.values[iB] * D.values[i];
+    }
+    else if (iC0 == i) {
+      A.values[i] = C.values[iC] * D.values[i];
+    }
+    iB += (uint32_t)(iB0 == i);
+    iC += (uint32_t)(iC0 == i);
+  }
+  while (iB < pB_end) {
+    uint32_t i = B.crd[iB];
+    A.values[i] = B.values[iB] * D.values[i];
+    iB++;
+  }
+  while (iC < pC_end) {
+    uint32_t i = C.crd[iC];
+    A.values[i] = C.values[iC] * D.values[i];
+    iC++;
+  }
+}
+
+
+void run_test(const int N, const double sparsity) {
+    array A_kernel = empty_dense_array(N);
+    array A_ref = empty_dense_array(N);
+    array B = random_sparse_array(N, sparsity);
+    array C = random_sparse_array(N, sparsity);
+    array D = random_dense_array(N);
+
+    kernel(A_kernel, B, C, D);
+    reference(A_ref, B, C, D);
+
+    assert_dense_array_match(A_kernel, A_ref, N);
+
+    std::cout << "Success\n";
+}
+
+// B ends early, so the loop over C alone runs over many nonzeros, a number
+// that is not a multiple of the streams, spread over the whole extent.
+void run_tail_test(const int N, const int stride) {
+    array A_kernel = empty_dense_array(N);
+    array A_ref = empty_dense_array(N);
+    std::vector<uint64_t> b_crd = {0, 1, 5};
+    std::vector<uint64_t> c_crd;
+    for (int i = 1; i < N; i += stride) {
+        c_crd.push_back(i);
+    }
+    array B = sparse_array_at(N, b_crd);
+    array C = sparse_array_at(N, c_crd);
+    array D = random_dense_array(N);
+
+    kernel(A_kernel, B, C, D);
+    reference(A_ref, B, C, D);
+
+    assert_dense_array_match(A_kernel, A_ref, N);
+
+    std::cout << "Success\n";
+}
+
+int main(const int argc, const char** argv) {
+    srand(0);
+    run_test(3, 0.5);
+    run_test(10, 0.1);
+    run_test(10, 0.5);
+    run_test(1000, 0.3);
+    run_test(1000, 0.9);
+    run_tail_test(10000, 3);
+    run_tail_test(10001, 7);
+}
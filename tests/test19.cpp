@@ -0,0 +1,32 @@
+#include <cassert>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+
+#include "project.h"
+
+
+
+int main(const int argc, const char** argv) {
+    Index i{"i"};
+    Array A{"A"}, B{"B"}, C{"C"}, D{"D"}, T{"T"};
+
+    // T is a temporary: the fused kernel computes A without writing it.
+    Assignment fused = fuse({
+        (T(i) = B(i) + C(i)),
+        (A(i) = T(i) * D(i)),
+    });
+    std::stringstream printed;
+    printed << fused;
+    assert(printed.str() == "A(i) = ((B(i) + C(i)) * D(i))");
+
+    FormatMap formats = {
+        {"A", {Format::Dense}},
+        {"B", {Format::Compressed}},
+        {"C", {Format::Compressed}},
+        {"D", {Format::Dense}},
+    };
+    compile_and_test(fused, formats, "tests/test19_runner.cpp");
+
+    return 0;
+}
@@ -0,0 +1,29 @@
+#include <cassert>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include "project.h"
+
+
+
+int main(const int argc, const char** argv) {
+    Index i{"i"};
+    Array A{"A"}, B{"B"}, C{"C"}, E{"E"};
+
+    // Both outputs are computed in one pass over B and C.
+    std::vector<Assignment> assignments = {
+        (A(i) = B(i) * C(i)),
+        (E(i) = B(i) + C(i)),
+    };
+    FormatMap formats = {
+        {"A", {Format::Dense}},
+        {"B", {Format::Compressed}},
+        {"C", {Format::Compressed}},
+        {"E", {Format::Dense}},
+    };
+    compile_sharded_and_test(assignments, formats, "tests/test20_runner.cpp");
+
+    return 0;
+}
@@ -0,0 +1,74 @@
+#include <cstdint>
+#include <iostream>
+#include <cstdlib>
+
+#include "utils.h"
+
+
+void reference(array &A, const array &B, const array &C, array &E) {
+  uint32_t iB = B.pos[0];
+  uint32_t pB_end = B.pos[1];
+  uint32_t iC = C.pos[0];
+  uint32_t pC_end = C.pos[1];
+
+  while (iB < pB_end && iC < pC_end) {
+    uint32_t iB0 = B.crd[iB];
+    uint32_t iC0 = C.crd[iC];
+    uint32_t i = min(iB0, iC0);
+    if (iB0 == i && iC0 == i) {
+      A.values[i] = B.values[iB] * C.values[iC];
+      E.values[i] = B.values[iB] + C.values[iC];
+    }
+    else if (iB0 == i) {
+      E.values[i] = B.values[iB];
+    }
+    else if (iC0 == i) {
+      E.values[i] = C.values[iC];
+    }
+    iB += (uint32_t)(iB0 == i);
+    iC += (uint32_t)(iC0 == i);
+  }
+  while (iB < pB_end) {
+    uint32_t i = B.crd[iB];
+    E.values[i] = B.values[iB];
+    iB++;
+  }
+  while (iC < pC_end) {
+    uint32_t i = C.crd[iC];
+    E.values[i] = C.values[iC];
+    iC++;
+  }
+}
+
+
+void run_test(const int N, const double sparsity) {
+    array A_kernel = empty_dense_array(N);
+    array E_kernel = empty_dense_array(N);
+    array A_sharded = empty_dense_array(N);
+    array E_sharded = empty_dense_array(N);
+    array A_ref = empty_dense_array(N);
+    array E_ref = empty_dense_array(N);
+    array B = random_sparse_array(N, sparsity);
+    array C = random_sparse_array(N, sparsity);
+
+    kernel(A_kernel, B, C, E_kernel);
+    const uint64_t failed = kernel_sharded(3, A_sharded, B, C, E_sharded);
+    reference(A_ref, B, C, E_ref);
+
+    assert(failed == 0);
+    assert_dense_array_match(A_kernel, A_ref, N);
+    assert_dense_array_match(E_kernel, E_ref, N);
+    assert_dense_array_match(A_sharded, A_ref, N);
+    assert_dense_array_match(E_sharded, E_ref, N);
+
+    std::cout << "Success\n";
+}
+
+int main(const int argc, const char** argv) {
+    srand(0);
+    run_test(3, 0.5);
+    run_test(10, 0.1);
+    run_test(10, 0.5);
+    run_test(1000, 0.3);
+    run_test(1000, 0.9);
+}
@@ -0,0 +1,32 @@
+#include <cassert>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+
+#include "project.h"
+
+
+
+int main(const int argc, const char** argv) {
+    Index i{"i"};
+    Array A{"A"}, B{"B"}, C{"C"}, D{"D"};
+
+    Assignment a = (A(i) = (B(i) * C(i) + D(i)) * (B(i) * C(i)));
+    FormatMap formats = {
+        {"A", {Format::Dense}},
+        {"B", {Format::Compressed}},
+        {"C", {Format::Compressed}},
+        {"D", {Format::Compressed}},
+    };
+
+    // B(i) * C(i) is computed once per point.
+    LIR::Stmt lstmt = lower(lower(a), formats);
+    std::stringstream printed;
+    printed << lstmt;
+    assert(printed.str().find("const float cse_t0 = (B.values[B_i_iter] * C.values[C_i_iter]);") != std::string::npos);
+    assert(printed.str().find("(B.values[B_i_iter] * C.values[C_i_iter]) + D") == std::string::npos);
+
+    compile_and_test(a, formats, "tests/test21_runner.cpp");
+
+    return 0;
+}
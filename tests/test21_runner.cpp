@@ -0,0 +1,56 @@
+#include <cstdint>
+#include <iostream>
+#include <cstdlib>
+#include <vector>
+
+#include "utils.h"
+
+
+void reference(array &A, const array &B, const array &C, const array &D) {
+  const uint64_t N = A.shape[0];
+  std::vector<bool> in_B(N), in_C(N);
+  std::vector<float> b(N), c(N), d(N);
+  for (uint64_t p = B.pos[0]; p < B.pos[1]; p++) {
+    in_B[B.crd[p]] = true;
+    b[B.crd[p]] = B.values[p];
+  }
+  for (uint64_t p = C.pos[0]; p < C.pos[1]; p++) {
+    in_C[C.crd[p]] = true;
+    c[C.crd[p]] = C.values[p];
+  }
+  for (uint64_t p = D.pos[0]; p < D.pos[1]; p++) {
+    d[D.crd[p]] = D.values[p];
+  }
+
+  for (uint64_t i = 0; i < N; i++) {
+    if (in_B[i] && in_C[i]) {
+      const float bc = b[i] * c[i];
+      A.values[i] = (bc + d[i]) * bc;
+    }
+  }
+}
+
+
+void run_test(const int N, const double sparsity) {
+    array A_kernel = empty_dense_array(N);
+    array A_ref = empty_dense_array(N);
+    array B = random_sparse_array(N, sparsity);
+    array C = random_sparse_array(N, sparsity);
+    array D = random_sparse_array(N, sparsity);
+
+    kernel(A_kernel, B, C, D);
+    reference(A_ref, B, C, D);
+
+    assert_dense_array_match(A_kernel, A_ref, N);
+
+    std::cout << "Success\n";
+}
+
+int main(const int argc, const char** argv) {
+    srand(0);
+    run_test(3, 0.5);
+    run_test(10, 0.1);
+    run_test(10, 0.5);
+    run_test(1000, 0.3);
+    run_test(1000, 0.9);
+}
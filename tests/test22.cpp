@@ -0,0 +1,31 @@
+#include <cassert>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+
+#include "project.h"
+
+
+
+int main(const int argc, const char** argv) {
+    Index i{"i"};
+    Array A{"A"}, B{"B"}, C{"C"}, D{"D"};
+
+    Assignment a = (A(i) = B(i) * C(i) + B(i) * D(i));
+    FormatMap formats = {
+        {"A", {Format::Dense}},
+        {"B", {Format::Compressed}},
+        {"C", {Format::Compressed}},
+        {"D", {Format::Compressed}},
+    };
+
+    Assignment rewritten = rewrite(a, formats);
+    std::stringstream printed;
+    printed << rewritten;
+    assert(printed.str() == "A(i) = (B(i) * (C(i) + D(i)))");
+    assert(lattice_cost(rewritten, formats) < lattice_cost(a, formats));
+
+    compile_and_test(rewritten, formats, "tests/test22_runner.cpp");
+
+    return 0;
+}
@@ -0,0 +1,52 @@
+#include <cassert>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+
+#include "project.h"
+
+
+
+int main(const int argc, const char** argv) {
+    Index i{"i"};
+    Array A{"A"}, B{"B"}, C{"C"}, D{"D"};
+
+    FormatMap formats = {
+        {"A", {Format::Dense}},
+        {"B", {Format::Compressed}},
+        {"C", {Format::Compressed}},
+        {"D", {Format::Dense}},
+    };
+
+    // Equal sets have one canonical form, and share one lattice point.
+    SetExpr b_or_c = Union::make(ArrayDim::make(B(i)), ArrayDim::make(C(i)));
+    SetExpr c_or_b_or_b = Union::make(Union::make(ArrayDim::make(C(i)), ArrayDim::make(B(i))), ArrayDim::make(B(i)));
+    assert(canonicalize(c_or_b_or_b) == canonicalize(b_or_c));
+    auto lattice_size = [&](const Assignment &a) {
+        auto forall = std::dynamic_pointer_cast<const ForAll>(lower(a).ptr);
+        return MergeLattice::make(forall->sexpr, forall->body, formats).node_map.size();
+    };
+    assert(lattice_size(A(i) = B(i) * C(i) + C(i) * B(i)) == lattice_size(A(i) = B(i) * C(i)));
+
+    // Equivalent assignments share one key, and one compiled kernel.
+    Assignment a = (A(i) = D(i) * (C(i) + B(i)));
+    Assignment b = (A(i) = (B(i) + C(i)) * D(i));
+    std::stringstream printed;
+    printed << canonicalize(a);
+    assert(printed.str() == "A(i) = ((B(i) + C(i)) * D(i))");
+    assert(kernel_cache_key(a, formats) == kernel_cache_key(b, formats));
+
+    FormatMap dense_c = formats;
+    dense_c["C"] = {Format::Dense};
+    assert(kernel_cache_key(a, formats) != kernel_cache_key(a, dense_c));
+
+    KernelCache cache;
+    const CachedKernel &kernel_a = compile_cached(cache, a, formats);
+    const CachedKernel &kernel_b = compile_cached(cache, b, formats);
+    assert(&kernel_a == &kernel_b && cache.kernels.size() == 1);
+    assert((kernel_a.arg_list == std::vector<std::string>{"A", "B", "C", "D"}));
+
+    compile_and_test(canonicalize(a), formats, "tests/test23_runner.cpp");
+
+    return 0;
+}
@@ -0,0 +1,40 @@
+#include <cassert>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <unordered_set>
+
+#include "project.h"
+
+
+
+int main(const int argc, const char** argv) {
+    Index i{"i"}, j{"j"};
+    Array A{"A"}, B{"B"}, C{"C"}, D{"D"};
+
+    // Structurally equal nodes are one node.
+    Expr e = (B(i) + C(i)) * D(i);
+    Expr f = (B(i) + C(i)) * D(i);
+    assert(e == f && e.ptr->id == f.ptr->id && ExprHash()(e) == ExprHash()(f));
+    assert(!(e == Expr((C(i) + B(i)) * D(i))));
+    assert(!(Expr(B(i)) == Expr(B(j))));
+
+    SetExpr s = Union::make(ArrayDim::make(B(i)), ArrayDim::make(C(i)));
+    SetExpr t = Union::make(ArrayDim::make(B(i)), ArrayDim::make(C(i)));
+    assert(s == t && !SetComparator()(s, t) && !SetComparator()(t, s));
+    assert(!(s == SetExpr(Intersection::make(ArrayDim::make(B(i)), ArrayDim::make(C(i))))));
+
+    std::unordered_set<SetExpr, SetExprHash> sets = {s, t, ArrayDim::make(B(i))};
+    assert(sets.size() == 2);
+
+    Assignment a = (A(i) = e);
+    FormatMap formats = {
+        {"A", {Format::Dense}},
+        {"B", {Format::Compressed}},
+        {"C", {Format::Compressed}},
+        {"D", {Format::Dense}},
+    };
+    compile_and_test(a, formats, "tests/test24_runner.cpp");
+
+    return 0;
+}
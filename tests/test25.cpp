@@ -0,0 +1,54 @@
+#include <cassert>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <unordered_set>
+
+#include "project.h"
+
+
+
+int main(const int argc, const char** argv) {
+    Index i{"i"};
+    Array A{"A"}, B{"B"}, C{"C"}, D{"D"};
+
+    // Symbols with equal names are equal, and still read as strings.
+    Symbol b("B"), b2(std::string("B")), c("C");
+    assert(b == b2 && b != c && b < c);
+    assert(b.str() == "B" && "load " + b == "load B");
+    std::unordered_set<Symbol> symbols = {b, b2, c};
+    assert(symbols.size() == 2);
+
+    // Kind tags select the node type without dynamic casts.
+    Expr e = (B(i) + C(i)) * D(i);
+    assert(e.ptr->kind == ExprKind::Mul);
+    assert(e.as<Mul>() && !e.as<Add>());
+    assert(e.as<Mul>()->a.as<Add>());
+
+    FormatMap formats = {
+        {"A", {Format::Dense}},
+        {"B", {Format::Compressed}},
+        {"C", {Format::Compressed}},
+        {"D", {Format::Dense}},
+    };
+    Assignment a = (A(i) = e);
+    {
+        // IR made while an arena is in scope comes from the arena, and must
+        // be gone by the end of the scope.
+        IRArena arena;
+        IndexStmt stmt = lower(a);
+        assert(stmt.as<ForAll>() && !stmt.as<ArrayAssignment>());
+        LIR::Stmt lstmt = lower(stmt, formats);
+        assert(arena.allocated() > 0);
+        assert(IRArena::current() == &arena);
+        std::stringstream printed;
+        IRPrinter printer(printed);
+        lstmt.accept(&printer);
+        assert(!printed.str().empty());
+    }
+    assert(IRArena::current() == nullptr);
+
+    compile_and_test(a, formats, "tests/test25_runner.cpp");
+
+    return 0;
+}
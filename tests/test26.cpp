@@ -0,0 +1,46 @@
+#include <cassert>
+#include <cstdio>
+#include <iostream>
+
+#include "project.h"
+
+
+
+int main(const int argc, const char** argv) {
+    Index i{"i"};
+    Array A{"A"}, B{"B"}, C{"C"}, D{"D"};
+
+    FormatMap formats = {
+        {"A", {Format::Dense}},
+        {"B", {Format::Compressed}},
+        {"C", {Format::Compressed}},
+        {"D", {Format::Dense}},
+    };
+
+    // (B ∪ C) ∩ D has points {B, C, D}, {B, D} and {C, D}. Each is built
+    // once, even though both children of the root reach nothing further.
+    Assignment a = (A(i) = (B(i) + C(i)) * D(i));
+    auto forall = lower(a).as<ForAll>();
+    MergeLattice lattice = MergeLattice::make(forall->sexpr, forall->body, formats);
+    assert(lattice.operands.size() == 3);
+    assert(lattice.points.size() == 3 && lattice.node_map.size() == 3);
+    assert(lattice.root == lattice.points.front().get());
+    assert(lattice.root->operands == OperandMask({true, true, true}));
+    assert(lattice.get_sub_points(*lattice.root).size() == 2);
+    for (const auto &point : lattice.points) {
+        assert(lattice.points[point->index] == point);
+        if (point.get() != lattice.root) {
+            assert(point->children.empty() && lattice.get_sub_points(*point).empty());
+            assert(point->iterators.size() == 1 && point->locators.size() == 1);
+        }
+    }
+
+    // Repeated operands are one bit.
+    Assignment b = (A(i) = (B(i) + C(i)) * (B(i) + D(i)));
+    forall = lower(b).as<ForAll>();
+    assert(MergeLattice::make(forall->sexpr, forall->body, formats).operands.size() == 3);
+
+    compile_and_test(a, formats, "tests/test26_runner.cpp");
+
+    return 0;
+}
@@ -0,0 +1,54 @@
+#include <cassert>
+#include <cstdio>
+#include <iostream>
+
+#include "project.h"
+
+
+
+int main(const int argc, const char** argv) {
+    Index i{"i"};
+    Array A{"A"}, B{"B"}, C{"C"}, D{"D"};
+
+    Assignment a = (A(i) = B(i) + (C(i) * D(i)));
+    FormatMap formats = {
+        {"A", {Format::Dense}},
+        {"B", {Format::Compressed}},
+        {"C", {Format::Compressed}},
+        {"D", {Format::Compressed}},
+    };
+    const uint64_t N = 1000000;
+    auto stats = [&](const uint64_t nnz) {
+        return OperandStatsMap{{"A", {N, N}}, {"B", {N, nnz}}, {"C", {N, nnz}}, {"D", {N, nnz}}};
+    };
+
+    // Every strategy applies, and costs more on more nonzeros.
+    const IndexStmt stmt = lower(a);
+    const std::vector<LoweringStrategy> strategies = lowering_strategies(stmt, formats);
+    assert(strategies.size() == 3);
+    for (const LoweringStrategy strategy : strategies) {
+        const LIR::Stmt lstmt = lower(stmt, formats, strategy);
+        assert(estimate_cost(lstmt, stats(1000)).total() < estimate_cost(lstmt, stats(100000)).total());
+        compile_and_test(lstmt, {"A", "B", "C", "D"}, "tests/test27_runner.cpp");
+    }
+
+    // Very sparse operands are merged: scattering would zero the whole
+    // output first. Denser ones are cheaper to scatter one term at a time.
+    assert(choose_strategy(stmt, formats, stats(1000)) == LoweringStrategy::Merge);
+    assert(choose_strategy(stmt, formats, stats(100000)) == LoweringStrategy::Scatter);
+
+    // Unions of many sparse operands are merged with a heap.
+    Array E{"E"}, F{"F"}, G{"G"}, H{"H"}, J{"J"}, K{"K"}, L{"L"}, M{"M"}, P{"P"};
+    Assignment wide = (A(i) = B(i) + C(i) + D(i) + E(i) + F(i) + G(i) + H(i) + J(i) + K(i) + L(i) + M(i) + P(i));
+    FormatMap wide_formats = {{"A", {Format::Dense}}};
+    OperandStatsMap wide_stats = {{"A", {N, N}}};
+    for (const auto &name : {"B", "C", "D", "E", "F", "G", "H", "J", "K", "L", "M", "P"}) {
+        wide_formats[name] = {Format::Compressed};
+        wide_stats[name] = {N, 100};
+    }
+    assert(choose_strategy(lower(wide), wide_formats, wide_stats) == LoweringStrategy::KWayMerge);
+
+    compile_and_test(a, formats, stats(1000), "tests/test27_runner.cpp");
+
+    return 0;
+}
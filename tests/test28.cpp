@@ -0,0 +1,37 @@
+#include <cassert>
+#include <cstdio>
+#include <iostream>
+
+#include "project.h"
+
+
+
+int main(const int argc, const char** argv) {
+    Index i{"i"};
+    Array A{"A"}, B{"B"}, C{"C"};
+
+    Assignment a = (A(i) = B(i) * C(i));
+    FormatMap formats = {
+        {"A", {Format::Dense}},
+        {"B", {Format::Compressed}},
+        {"C", {Format::Compressed}},
+    };
+
+    // Merge, dense-locator, and galloping led by each operand.
+    const std::vector<KernelVariant> variants = lower_variants(lower(a), formats);
+    assert(variants.size() == 4);
+    assert(variants[0].kind == KernelVariantKind::Merge);
+    assert(variants[1].kind == KernelVariantKind::DenseLocate);
+    assert(variants[2].kind == KernelVariantKind::Gallop && variants[2].lead == "B");
+    assert(variants[3].kind == KernelVariantKind::Gallop && variants[3].lead == "C");
+
+    // Unions can't gallop, and dense operands are merged only.
+    assert(lower_variants(lower(A(i) = B(i) + C(i)), formats).size() == 2);
+    FormatMap mixed = formats;
+    mixed["C"] = {Format::Dense};
+    assert(lower_variants(lower(a), mixed).size() == 1);
+
+    compile_versioned_and_test(a, formats, "tests/test28_runner.cpp");
+
+    return 0;
+}
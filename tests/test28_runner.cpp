@@ -0,0 +1,59 @@
+#include <cstdint>
+#include <iostream>
+#include <cstdlib>
+
+#include "utils.h"
+
+
+void reference(array &A, const array &B, const array &C) {
+    uint64_t B_d0_iter = B.pos[0];
+    uint64_t C_d0_iter = C.pos[0];
+    while ((B_d0_iter < B.pos[1]) && (C_d0_iter < C.pos[1])) {
+        uint64_t B_d0 = B.crd[B_d0_iter];
+        uint64_t C_d0 = C.crd[C_d0_iter];
+        uint64_t d0 = min(B_d0, C_d0);
+        if ((B_d0 == d0) && (C_d0 == d0)) {
+            A.values[d0] = (B.values[B_d0_iter] * C.values[C_d0_iter]);
+        }
+        B_d0_iter += (d0 == B_d0);
+        C_d0_iter += (d0 == C_d0);
+    }
+}
+
+
+// Every variant, and the prologue choosing between them, computes the
+// reference result.
+void run_test(const int N, const double B_sparsity, const double C_sparsity) {
+    array B = random_sparse_array(N, B_sparsity);
+    array C = random_sparse_array(N, C_sparsity);
+    array A_ref = empty_dense_array(N);
+    reference(A_ref, B, C);
+
+    for (auto variant : {kernel, kernel_merge, kernel_dense_locate, kernel_gallop_B, kernel_gallop_C}) {
+        array A_kernel = empty_dense_array(N);
+        variant(A_kernel, B, C);
+        assert_dense_array_match(A_kernel, A_ref, N);
+    }
+
+    std::cout << "Success\n";
+}
+
+int main(const int argc, const char** argv) {
+    srand(0);
+
+    // Operands of similar sparsity are merged, one much sparser than the
+    // other leads a gallop, and nearly full ones are located.
+    const uint64_t similar[2] = {1000, 1000};
+    const uint64_t skewed[2] = {10, 100000};
+    const uint64_t full[2] = {95000, 95000};
+    ASSERT(merge_variant_cost(similar, 2) < gallop_variant_cost(similar, 2, 0), "similar");
+    ASSERT(gallop_variant_cost(skewed, 2, 0) < merge_variant_cost(skewed, 2), "skewed");
+    ASSERT(gallop_variant_cost(skewed, 2, 0) < gallop_variant_cost(skewed, 2, 1), "skewed lead");
+    ASSERT(dense_locate_variant_cost(100000, 2) < merge_variant_cost(full, 2), "full");
+
+    run_test(10, 0.5, 0.5);
+    run_test(1000, 0.1, 0.1);
+    run_test(10000, 0.001, 0.5);
+    run_test(10000, 0.5, 0.001);
+    run_test(10000, 0.95, 0.95);
+}
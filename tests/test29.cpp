@@ -0,0 +1,60 @@
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+#include "project.h"
+
+
+
+int main(const int argc, const char** argv) {
+    Index i{"i"};
+    Array A{"A"}, B{"B"}, C{"C"};
+
+    Assignment a = (A(i) = B(i) * C(i));
+
+    // B has a nonzero at one coordinate in a thousand, C at every one.
+    FormatSample sample;
+    sample.extent = 1 << 20;
+    sample.values["B"].assign(sample.extent, 0.0f);
+    sample.values["C"].assign(sample.extent, 2.0f);
+    for (uint64_t k = 0; k < sample.extent; k += 1000) {
+        sample.values["B"][k] = 1.0f;
+    }
+    sample.formats = {
+        {"A", {Format::Dense}},
+        {"B", {Format::Compressed}},
+        {"C", {Format::Dense}},
+    };
+
+    const std::vector<FormatMap> candidates = candidate_formats(a, sample.formats);
+    assert(candidates.size() == 4);
+    for (const auto &candidate : candidates) {
+        assert(candidate.at("A").front() == Format::Dense);
+    }
+
+    double seconds = -1;
+    assert(time_formats(a, candidates.front(), sample, seconds) && seconds >= 0);
+
+    // Gathering from C at the nonzeros of B beats visiting every coordinate.
+    const std::string cache_file = "/tmp/cs343_test29_formats";
+    std::remove(cache_file.c_str());
+    const FormatMap formats = autotune_formats(a, sample, cache_file);
+    assert(formats.at("B").front() == Format::Compressed);
+    assert(formats.at("C").front() == Format::Dense);
+
+    // The winner is persisted, and reused for samples of the same density.
+    std::string line;
+    std::ifstream persisted(cache_file);
+    assert(std::getline(persisted, line) && line.find("B:c C:d") != std::string::npos);
+    persisted.close();
+    std::ofstream(cache_file) << line.substr(0, line.find('\t')) << "\tA:d B:d C:c\n";
+    const FormatMap reused = autotune_formats(a, sample, cache_file);
+    assert(reused.at("B").front() == Format::Dense);
+    assert(reused.at("C").front() == Format::Compressed);
+    std::remove(cache_file.c_str());
+
+    compile_and_test(a, formats, "tests/test29_runner.cpp");
+
+    return 0;
+}
@@ -0,0 +1,37 @@
+#include <cstdint>
+#include <iostream>
+#include <cstdlib>
+
+#include "utils.h"
+
+
+void reference(array &A, const array &B, const array &C) {
+    for (uint64_t p = B.pos[0]; p < B.pos[1]; p++) {
+        const uint64_t i = B.crd[p];
+        A.values[i] = B.values[p] * C.values[i];
+    }
+}
+
+
+void run_test(const int N, const double sparsity) {
+    array A_kernel = empty_dense_array(N);
+    array A_ref = empty_dense_array(N);
+    array B = random_sparse_array(N, sparsity);
+    array C = random_dense_array(N);
+
+    kernel(A_kernel, B, C);
+    reference(A_ref, B, C);
+
+    assert_dense_array_match(A_kernel, A_ref, N);
+
+    std::cout << "Success\n";
+}
+
+int main(const int argc, const char** argv) {
+    srand(0);
+    run_test(10, 0.5);
+    run_test(100, 0.1);
+    run_test(1000, 0.01);
+    run_test(10000, 0.001);
+    run_test(10000, 0.5);
+}
@@ -0,0 +1,44 @@
+#include <cassert>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+
+#include "project.h"
+
+
+
+int main(const int argc, const char** argv) {
+    Index i{"i"};
+    Array A{"A"}, B{"B"}, C{"C"}, D{"D"};
+
+    Assignment a = (A(i) = B(i) * (C(i) + D(i)));
+    FormatMap formats = {
+        {"A", {Format::Dense}},
+        {"B", {Format::Compressed}},
+        {"C", {Format::Compressed}},
+        {"D", {Format::Compressed}},
+    };
+
+    // Train on the runner's data, where D is much denser than C.
+    const std::string profile_file = "/tmp/cs343_test30_profile";
+    std::remove(profile_file.c_str());
+    compile_instrumented_and_test(a, formats, profile_file, "tests/test30_runner.cpp");
+    const BranchProfile profile = read_branch_profile(profile_file);
+    std::remove(profile_file.c_str());
+    assert(profile.count("B,C,D") != 0);
+    assert(profile.count("B,C,D/B,D") > profile.count("B,C,D/B,C"));
+
+    // The loop over B, C and D tests B and D before B and C alone, and moves
+    // the rare cases out of line.
+    std::ostringstream printed;
+    printed << lower(lower(a), formats, profile);
+    const std::string kernel = printed.str();
+    const size_t hot = kernel.find("else if ((B_i == i) && (D_i == i)) {");
+    const size_t rare = kernel.find("else if (__builtin_expect((B_i == i) && (C_i == i), 0)) {");
+    assert(hot != std::string::npos && rare != std::string::npos && hot < rare);
+    assert(kernel.find("__attribute__((noinline, cold))") != std::string::npos);
+
+    compile_and_test(a, formats, profile, "tests/test30_runner.cpp");
+
+    return 0;
+}
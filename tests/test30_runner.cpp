@@ -0,0 +1,60 @@
+#include <cstdint>
+#include <iostream>
+#include <cstdlib>
+
+#include "utils.h"
+
+
+// Values of a sparse array at every coordinate, zero where it has no nonzero.
+float *densify(const array &A) {
+    float *values = new float[A.shape[0]]();
+    for (uint64_t p = A.pos[0]; p < A.pos[1]; p++) {
+        values[A.crd[p]] = A.values[p];
+    }
+    return values;
+}
+
+
+void reference(array &A, const array &B, const array &C, const array &D) {
+    const uint64_t N = A.shape[0];
+    float *b = densify(B), *c = densify(C), *d = densify(D);
+    bool *in_c = new bool[N](), *in_d = new bool[N]();
+    for (uint64_t p = C.pos[0]; p < C.pos[1]; p++) {
+        in_c[C.crd[p]] = true;
+    }
+    for (uint64_t p = D.pos[0]; p < D.pos[1]; p++) {
+        in_d[D.crd[p]] = true;
+    }
+    for (uint64_t p = B.pos[0]; p < B.pos[1]; p++) {
+        const uint64_t i = B.crd[p];
+        if (in_c[i] || in_d[i]) {
+            A.values[i] = b[i] * (c[i] + d[i]);
+        }
+    }
+}
+
+
+void run_test(const int N, const double B_sparsity, const double C_sparsity, const double D_sparsity) {
+    array A_kernel = empty_dense_array(N);
+    array A_ref = empty_dense_array(N);
+    array B = random_sparse_array(N, B_sparsity);
+    array C = random_sparse_array(N, C_sparsity);
+    array D = random_sparse_array(N, D_sparsity);
+
+    kernel(A_kernel, B, C, D);
+    reference(A_ref, B, C, D);
+
+    assert_dense_array_match(A_kernel, A_ref, N);
+
+    std::cout << "Success\n";
+}
+
+int main(const int argc, const char** argv) {
+    srand(0);
+    // D is much denser than C, so B meets D far more often than C alone.
+    run_test(10, 0.5, 0.2, 0.5);
+    run_test(1000, 0.5, 0.01, 0.5);
+    run_test(10000, 0.5, 0.01, 0.5);
+    run_test(10000, 0.2, 0.001, 0.8);
+    run_test(100000, 0.5, 0.001, 0.5);
+}
@@ -0,0 +1,31 @@
+#include <cassert>
+#include <cstdio>
+#include <iostream>
+
+#include "project.h"
+
+
+
+int main(const int argc, const char** argv) {
+    Index i{"i"}, i0{"i0"}, i1{"i1"};
+    Array A{"A"}, B{"B"}, C{"C"}, D{"D"}, E{"E"};
+
+    Assignment a = (A(i) = B(i) * C(i) + D(i) * E(i));
+    FormatMap formats = {
+        {"A", {Format::Dense}},
+        {"B", {Format::Compressed}},
+        {"C", {Format::Dense}},
+        {"D", {Format::Compressed}},
+        {"E", {Format::Dense}},
+    };
+
+    // Each shard runs the blocks of the split within its own range only,
+    // for both the merged and the scattered kernel.
+    IndexStmt stmt = lower(a).split(i, i0, i1, 64);
+    for (const LoweringStrategy strategy : {LoweringStrategy::Merge, LoweringStrategy::Scatter}) {
+        LIR::Stmt lstmt = lower(stmt, formats, strategy);
+        compile_sharded_and_test(lstmt, {"A", "B", "C", "D", "E"}, "tests/test31_runner.cpp");
+    }
+
+    return 0;
+}
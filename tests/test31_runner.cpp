@@ -0,0 +1,62 @@
+#include <cstdint>
+#include <iostream>
+#include <cstdlib>
+
+#include "utils.h"
+
+
+void reference(array &A, const array &B, const array &C, const array &D, const array &E) {
+  for (uint64_t i = 0; i < A.shape[0]; i++) {
+    A.values[i] = 0;
+  }
+  for (uint64_t p = B.pos[0]; p < B.pos[1]; p++) {
+    A.values[B.crd[p]] += B.values[p] * C.values[B.crd[p]];
+  }
+  for (uint64_t p = D.pos[0]; p < D.pos[1]; p++) {
+    A.values[D.crd[p]] += D.values[p] * E.values[D.crd[p]];
+  }
+}
+
+
+void run_test(const int N, const double sparsity, const int P) {
+    array A_kernel = empty_dense_array(N);
+    array A_sharded = empty_dense_array(N);
+    array A_ref = empty_dense_array(N);
+    array B = random_sparse_array(N, sparsity);
+    array C = random_dense_array(N);
+    array D = random_sparse_array(N, sparsity);
+    array E = random_dense_array(N);
+
+    kernel(A_kernel, B, C, D, E);
+    const uint64_t failed = kernel_sharded(P, A_sharded, B, C, D, E);
+    reference(A_ref, B, C, D, E);
+
+    assert(failed == 0);
+    assert_dense_array_match(A_kernel, A_ref, N);
+    assert_dense_array_match(A_sharded, A_ref, N);
+
+    // A shard leaves the output outside its range alone.
+    const uint64_t begin = N / 3;
+    const uint64_t end = N / 2;
+    array A_shard = empty_dense_array(N);
+    for (int i = 0; i < N; i++) {
+      A_shard.values[i] = (i >= begin && i < end) ? 0 : -1;
+    }
+    kernel_shard(begin, end, A_shard, B, C, D, E);
+    for (int i = 0; i < N; i++) {
+      const float expected = (i >= begin && i < end) ? A_ref.values[i] : -1;
+      ASSERT(A_shard.values[i] == expected, "received: " << A_shard.values[i] << " but expected: " << expected << " at index " << i);
+    }
+
+    std::cout << "Success\n";
+}
+
+int main(const int argc, const char** argv) {
+    srand(0);
+    // Shards narrower than a block, and spanning many blocks.
+    run_test(100, 0.5, 4);
+    run_test(1000, 0.3, 3);
+    run_test(100000, 0.1, 4);
+    run_test(100000, 0.5, 4);
+    run_test(100000, 0.5, 7);
+}
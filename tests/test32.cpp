@@ -0,0 +1,27 @@
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <iostream>
+
+#include "project.h"
+
+
+
+int main(const int argc, const char** argv) {
+    Index i{"i"};
+    Array A{"A"}, B{"B"};
+
+    Assignment a = (A(i) = B(i) + A(i));
+    FormatMap formats = {
+        {"A", {Format::Dense}},
+        {"B", {Format::Compressed}},
+    };
+
+    // The output is also an operand, so it can't be zeroed and scattered into.
+    const std::vector<LoweringStrategy> strategies = lowering_strategies(lower(a), formats);
+    assert(std::find(strategies.cbegin(), strategies.cend(), LoweringStrategy::Scatter) == strategies.cend());
+
+    compile_and_test(a, formats, "tests/test32_runner.cpp");
+
+    return 0;
+}
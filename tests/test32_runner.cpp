@@ -0,0 +1,38 @@
+#include <cstdint>
+#include <iostream>
+#include <cstdlib>
+
+#include "utils.h"
+
+
+void reference(array &A, const array &B) {
+  for (uint64_t p = B.pos[0]; p < B.pos[1]; p++) {
+    A.values[B.crd[p]] = B.values[p] + A.values[B.crd[p]];
+  }
+}
+
+
+void run_test(const int N, const double sparsity) {
+    array A_kernel = random_dense_array(N);
+    array A_ref = empty_dense_array(N);
+    for (int i = 0; i < N; i++) {
+      A_ref.values[i] = A_kernel.values[i];
+    }
+    array B = random_sparse_array(N, sparsity);
+
+    kernel(A_kernel, B);
+    reference(A_ref, B);
+
+    assert_dense_array_match(A_kernel, A_ref, N);
+
+    std::cout << "Success\n";
+}
+
+int main(const int argc, const char** argv) {
+    srand(0);
+    run_test(1, 0.0);
+    run_test(10, 0.5);
+    run_test(100, 0.1);
+    run_test(1000, 0.3);
+    run_test(1000, 0.9);
+}
@@ -0,0 +1,27 @@
+#include <cassert>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+
+#include "project.h"
+
+
+
+int main(const int argc, const char** argv) {
+    Index i{"i"};
+    Array A{"A"}, B{"B"}, C{"C"}, D{"D"}, E{"E"};
+
+    Assignment a = (A(i) = ((B(i) + C(i)) + D(i)) * E(i));
+    FormatMap formats = {
+        {"A", {Format::Dense}},
+        {"B", {Format::Compressed}},
+        {"C", {Format::Compressed}},
+        {"D", {Format::Compressed}},
+        {"E", {Format::Compressed}},
+    };
+
+    compile_and_test(a, formats, "tests/test7_runner.cpp");
+
+    return 0;
+}
+
@@ -0,0 +1,54 @@
+#include <cstdint>
+#include <iostream>
+#include <cstdlib>
+#include <vector>
+
+#include "utils.h"
+
+
+void reference(array &A, const array &B, const array &C, const array &D, const array &E) {
+  const uint32_t N = A.shape[0];
+  const array *terms[3] = {&B, &C, &D};
+  std::vector<float> sum(N);
+  std::vector<bool> present(N, false);
+
+  for (const array *T : terms) {
+    for (uint32_t p = T->pos[0]; p < T->pos[1]; p++) {
+      uint32_t i = T->crd[p];
+      sum[i] = present[i] ? (sum[i] + T->values[p]) : T->values[p];
+      present[i] = true;
+    }
+  }
+  for (uint32_t p = E.pos[0]; p < E.pos[1]; p++) {
+    uint32_t i = E.crd[p];
+    if (present[i]) {
+      A.values[i] = sum[i] * E.values[p];
+    }
+  }
+}
+
+
+void run_test(const int N, const double sparsity) {
+    array A_kernel = empty_dense_array(N);
+    array A_ref = empty_dense_array(N);
+    array B = random_sparse_array(N, sparsity);
+    array C = random_sparse_array(N, sparsity);
+    array D = random_sparse_array(N, sparsity);
+    array E = random_sparse_array(N, sparsity);
+
+    kernel(A_kernel, B, C, D, E);
+    reference(A_ref, B, C, D, E);
+
+    assert_dense_array_match(A_kernel, A_ref, N);
+
+    std::cout << "Success\n";
+}
+
+int main(const int argc, const char** argv) {
+    srand(0);
+    run_test(10, 0.1);
+    run_test(10, 0.3);
+    run_test(10, 0.5);
+    run_test(10, 0.7);
+    run_test(10, 0.9);
+}
@@ -0,0 +1,31 @@
+#include <cassert>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+
+#include "project.h"
+
+
+
+int main(const int argc, const char** argv) {
+    Index i{"i"};
+    Array A{"A"}, B{"B"}, C{"C"}, D{"D"}, E{"E"}, F{"F"}, G{"G"}, H{"H"}, J{"J"};
+
+    Assignment a = (A(i) = B(i) + C(i) + D(i) + E(i) + F(i) + G(i) + H(i) + J(i));
+    FormatMap formats = {
+        {"A", {Format::Dense}},
+        {"B", {Format::Compressed}},
+        {"C", {Format::Compressed}},
+        {"D", {Format::Compressed}},
+        {"E", {Format::Compressed}},
+        {"F", {Format::Compressed}},
+        {"G", {Format::Compressed}},
+        {"H", {Format::Compressed}},
+        {"J", {Format::Compressed}},
+    };
+
+    compile_and_test(a, formats, "tests/test8_runner.cpp");
+
+    return 0;
+}
+
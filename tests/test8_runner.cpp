@@ -0,0 +1,46 @@
+#include <cstdint>
+#include <iostream>
+#include <cstdlib>
+#include <vector>
+
+#include "utils.h"
+
+
+void reference(array &A, const std::vector<array> &terms) {
+  const uint32_t N = A.shape[0];
+  std::vector<bool> present(N, false);
+
+  for (const array &T : terms) {
+    for (uint32_t p = T.pos[0]; p < T.pos[1]; p++) {
+      uint32_t i = T.crd[p];
+      A.values[i] = present[i] ? (A.values[i] + T.values[p]) : T.values[p];
+      present[i] = true;
+    }
+  }
+}
+
+
+void run_test(const int N, const double sparsity) {
+    array A_kernel = empty_dense_array(N);
+    array A_ref = empty_dense_array(N);
+    std::vector<array> terms;
+    for (int t = 0; t < 8; t++) {
+        terms.push_back(random_sparse_array(N, sparsity));
+    }
+
+    kernel(A_kernel, terms[0], terms[1], terms[2], terms[3], terms[4], terms[5], terms[6], terms[7]);
+    reference(A_ref, terms);
+
+    assert_dense_array_match(A_kernel, A_ref, N);
+
+    std::cout << "Success\n";
+}
+
+int main(const int argc, const char** argv) {
+    srand(0);
+    run_test(10, 0.1);
+    run_test(10, 0.3);
+    run_test(10, 0.5);
+    run_test(10, 0.7);
+    run_test(10, 0.9);
+}
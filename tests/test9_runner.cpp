@@ -0,0 +1,78 @@
+#include <cstdint>
+#include <iostream>
+#include <cstdlib>
+#include <vector>
+
+#include "utils.h"
+
+
+// Generate a sparse array whose nonzeros come in runs of consecutive coordinates.
+array clustered_sparse_array(const int N, const int max_run) {
+    std::vector<uint64_t> coords;
+    int i = rand() % max_run;
+    while (i < N) {
+        const int run = 1 + rand() % max_run;
+        for (int k = 0; k < run && i < N; k++, i++) {
+            coords.push_back(i);
+        }
+        i += rand() % max_run;
+    }
+
+    array A;
+    A.shape = new uint64_t[1]();
+    A.shape[0] = N;
+    A.pos = new uint64_t[2]();
+    A.crd = new uint64_t[coords.size()]();
+    A.values = new float[coords.size()]();
+    for (size_t p = 0; p < coords.size(); p++) {
+        A.crd[p] = coords[p];
+        A.values[p] = static_cast<float>(rand()) / static_cast<float>(RAND_MAX);
+    }
+    A.pos[0] = 0;
+    A.pos[1] = coords.size();
+    return A;
+}
+
+
+void reference(array &A, const array &B, const array &C) {
+    uint64_t B_d0_iter = B.pos[0];
+    uint64_t C_d0_iter = C.pos[0];
+    while ((B_d0_iter < B.pos[1]) && (C_d0_iter < C.pos[1])) {
+        uint64_t B_d0 = B.crd[B_d0_iter];
+        uint64_t C_d0 = C.crd[C_d0_iter];
+        uint64_t d0 = min(B_d0, C_d0);
+        if ((B_d0 == d0) && (C_d0 == d0)) {
+            A.values[d0] = (B.values[B_d0_iter] * C.values[C_d0_iter]);
+        }
+        B_d0_iter += (d0 == B_d0);
+        C_d0_iter += (d0 == C_d0);
+    }
+}
+
+
+void run_test(const int N, const int max_run, const bool aligned) {
+    array A_kernel = empty_dense_array(N);
+    array A_ref = empty_dense_array(N);
+    const unsigned seed = rand();
+    srand(seed);
+    array B = clustered_sparse_array(N, max_run);
+    // Aligned operands share their runs, so whole blocks intersect.
+    srand(aligned ? seed : rand());
+    array C = clustered_sparse_array(N, max_run);
+
+    kernel(A_kernel, B, C);
+    reference(A_ref, B, C);
+
+    assert_dense_array_match(A_kernel, A_ref, N);
+
+    std::cout << "Success\n";
+}
+
+int main(const int argc, const char** argv) {
+    srand(0);
+    run_test(10, 4, false);
+    run_test(100, 8, false);
+    run_test(1000, 16, true);
+    run_test(1000, 64, false);
+    run_test(10000, 256, true);
+}
@@ -2,6 +2,7 @@
 
 #include <cstdlib>
 #include <set>
+#include <vector>
 
 #include "runtime/array.h"
 
@@ -51,6 +52,23 @@ array random_sparse_array(const int N, const double sparsity) {
     return A;
 }
 
+// Generate a sparse array with random values at the given sorted coordinates.
+array sparse_array_at(const int N, const std::vector<uint64_t> &coordinates) {
+    array A;
+    A.shape = new uint64_t[1]();
+    A.shape[0] = N;
+    A.pos = new uint64_t[2]();
+    A.crd = new uint64_t[coordinates.size()]();
+    A.values = new float[coordinates.size()]();
+    for (size_t p = 0; p < coordinates.size(); p++) {
+        A.crd[p] = coordinates[p];
+        A.values[p] = static_cast<float>(rand()) / static_cast<float>(RAND_MAX);
+    }
+    A.pos[0] = 0;
+    A.pos[1] = coordinates.size();
+    return A;
+}
+
 array random_dense_array(const int N) {
     array A;
     A.shape = new uint64_t[1]();